@@ -51,7 +51,6 @@ const char *SONG = "assets/Angry Birds Theme Song.wav";
 const char *POINT_LABEL = "Points:";
 const char *SHOT_MARKER_LABEL = "Birds Remaining:";
 
-const size_t CIRC_NPOINTS = 100;
 const double ENEMY_RADIUS = 25;
 const double BIRD_RADIUS = 20;
 const double ENEMY_MASS = __DBL_MAX__;
@@ -72,7 +71,6 @@ const double GROUND_WEIGHT = 100000;
 
 const size_t SCENE_BIRD_INDEX = 0;
 
-const double WALL_DIM = 1;
 rgb_color_t white = (rgb_color_t){1, 1, 1};
 
 const vector_t SLING_SIZE = {30, 100};
@@ -91,6 +89,8 @@ struct state {
   asset_t *pause_button;
   asset_t *reset_button;
   body_t *ground;
+  // every block of wood shares this body's shape
+  body_t *wood_prototype;
   size_t curr_bird_num;
   list_t *backgrounds;
   list_t *birds;
@@ -115,10 +115,6 @@ body_type_t *make_type_info(body_type_t type) {
   return info;
 }
 
-body_type_t get_type(body_t *body) {
-  return *(body_type_t *)body_get_info(body);
-}
-
 void slingshot(state_t *state, bool mouse_type, double x, double y) {
   if (!(mouse_type)) {
     state->mouse = (vector_t){x, y};
@@ -152,13 +148,6 @@ void pig_bird_collision_handler(body_t *bird, body_t *enemy, vector_t axis,
   body_remove(enemy);
 }
 
-void create_pig_bird_collision(scene_t *scene, body_t *bird, body_t *enemy,
-                               double elasticity, state_t *state) {
-  create_collision(scene, bird, enemy,
-                   (collision_handler_t)pig_bird_collision_handler, state,
-                   elasticity);
-}
-
 void ground_wall_collision_handler(body_t *bird, body_t *boundary,
                                    vector_t axis, void *aux,
                                    double force_const) {
@@ -170,27 +159,6 @@ void ground_wall_collision_handler(body_t *bird, body_t *boundary,
   }
 }
 
-void create_ground_wall_collision(scene_t *scene, body_t *bird,
-                                  body_t *boundary, double elasticity,
-                                  state_t *state) {
-  create_collision(scene, bird, boundary,
-                   (collision_handler_t)ground_wall_collision_handler, state,
-                   elasticity);
-}
-
-list_t *make_circle(vector_t center, double radius) {
-  list_t *c = list_init(CIRC_NPOINTS, free);
-  for (size_t i = 0; i < CIRC_NPOINTS; i++) {
-    double angle = 2 * M_PI * i / CIRC_NPOINTS;
-    vector_t *v = malloc(sizeof(*v));
-    assert(v);
-    *v = (vector_t){center.x + radius * cos(angle),
-                    center.y + radius * sin(angle)};
-    list_add(c, v);
-  }
-  return c;
-}
-
 list_t *make_rectangle(vector_t center, double width, double height) {
   list_t *points = list_init(4, free);
   vector_t *p1 = malloc(sizeof(vector_t));
@@ -219,13 +187,14 @@ list_t *make_rectangle(vector_t center, double width, double height) {
 
 asset_t *make_enemy(state_t *state, double health, double mass,
                     free_func_t info_freer, vector_t loc) {
-  list_t *shape = make_circle(MIN, ENEMY_RADIUS);
-  enemy_body_t *ret = enemy_body_init_with_info(
-      health, shape, mass, white, make_type_info(ENEMY), info_freer);
+  enemy_body_t *ret = enemy_body_init_circle_with_info(
+      health, MIN, ENEMY_RADIUS, mass, white, make_type_info(ENEMY),
+      info_freer);
 
   body_t *body = enemy_body_get_body(ret);
 
   body_set_centroid(body, loc);
+  body_set_layer(body, ENEMY);
   scene_add_body(state->scene, body);
 
   asset_t *pig = asset_make_image_with_body(PIG_PATH, body);
@@ -237,11 +206,17 @@ asset_t *make_enemy(state_t *state, double health, double mass,
 asset_t *make_bird(state_t *state, double mass, rgb_color_t color,
                    free_func_t info_freer, vector_t loc, bool shooter) {
 
-  list_t *shape = make_circle(MIN, BIRD_RADIUS);
-  body_t *body = body_init_with_info(shape, mass, color,
-                                     make_type_info(PROJECTILE), info_freer);
+  body_t *body = body_init_circle_with_info(
+      MIN, BIRD_RADIUS, mass, color, make_type_info(PROJECTILE), info_freer);
 
   body_set_centroid(body, loc);
+  // launched birds are fast enough to pass through the thin walls
+  body_set_bullet(body, shooter);
+  body_set_layer(body, PROJECTILE);
+  // the birds waiting to be shot are only markers
+  if (!shooter) {
+    body_set_mask(body, 0);
+  }
   scene_add_body(state->scene, body);
   asset_t *bird = asset_make_image_with_body(BIRD_PATH, body);
   if (shooter) {
@@ -255,11 +230,10 @@ asset_t *make_bird(state_t *state, double mass, rgb_color_t color,
 
 asset_t *make_wood(state_t *state, double mass, rgb_color_t color,
                    vector_t loc) {
-  list_t *shape = make_rectangle(MIN, WOOD_WIDTH, WOOD_HEIGHT);
-  body_t *body =
-      body_init_with_info(shape, mass, color, make_type_info(WALL), free);
+  body_t *body = body_init_instance_with_info(
+      state->wood_prototype, loc, mass, color, make_type_info(WALL), free);
 
-  body_set_centroid(body, loc);
+  body_set_layer(body, WALL);
   scene_add_body(state->scene, body);
 
   asset_t *wall = asset_make_image_with_body(WOOD_PATH, body);
@@ -269,22 +243,24 @@ asset_t *make_wood(state_t *state, double mass, rgb_color_t color,
 }
 
 void add_walls(state_t *state) {
-  list_t *wall1_shape =
-      make_rectangle((vector_t){MAX.x, MAX.y / 2}, WALL_DIM, MAX.y);
-  body_t *wall1 = body_init_with_info(wall1_shape, __DBL_MAX__, white,
-                                      make_type_info(WALL), free);
-  list_t *wall2_shape =
-      make_rectangle((vector_t){0, MAX.y / 2}, WALL_DIM, MAX.y);
-  body_t *wall2 = body_init_with_info(wall2_shape, __DBL_MAX__, white,
-                                      make_type_info(WALL), free);
-  list_t *ceiling_shape =
-      make_rectangle((vector_t){MAX.x / 2, MAX.y}, MAX.x, WALL_DIM);
-  body_t *ceiling = body_init_with_info(ceiling_shape, __DBL_MAX__, white,
-                                        make_type_info(WALL), free);
-  list_t *ground_shape =
-      make_rectangle((vector_t){MAX.x / 2, 0}, MAX.x, WALL_DIM);
-  body_t *ground = body_init_with_info(ground_shape, GROUND_WEIGHT, white,
-                                       make_type_info(GROUND), free);
+  // the bounds of the world fill everything past them, so nothing can
+  // tunnel out of it however fast it goes
+  body_t *wall1 = body_init_half_plane_with_info(
+      (vector_t){MAX.x, MAX.y / 2}, (vector_t){-1, 0}, __DBL_MAX__, white,
+      make_type_info(WALL), free);
+  body_t *wall2 = body_init_half_plane_with_info(
+      (vector_t){0, MAX.y / 2}, (vector_t){1, 0}, __DBL_MAX__, white,
+      make_type_info(WALL), free);
+  body_t *ceiling = body_init_half_plane_with_info(
+      (vector_t){MAX.x / 2, MAX.y}, (vector_t){0, -1}, __DBL_MAX__, white,
+      make_type_info(WALL), free);
+  body_t *ground = body_init_half_plane_with_info(
+      (vector_t){MAX.x / 2, 0}, (vector_t){0, 1}, GROUND_WEIGHT, white,
+      make_type_info(GROUND), free);
+  body_set_layer(wall1, WALL);
+  body_set_layer(wall2, WALL);
+  body_set_layer(ceiling, WALL);
+  body_set_layer(ground, GROUND);
   state->ground = ground;
   scene_add_body(state->scene, wall1);
   scene_add_body(state->scene, wall2);
@@ -292,31 +268,19 @@ void add_walls(state_t *state) {
   scene_add_body(state->scene, ground);
 }
 
-void add_force_creators(state_t *state) {
-  for (size_t j = 0; j < list_size(state->birds); j++) {
-    body_t *bird = get_body(list_get(state->birds, j));
-    for (size_t i = 0; i < scene_bodies(state->scene); i++) {
-      body_t *body = scene_get_body(state->scene, i);
-      switch (get_type(body)) {
-      case ENEMY:
-        create_pig_bird_collision(state->scene, bird, body, ELASTICITY, state);
-        break;
-      case WALL:
-        create_ground_wall_collision(state->scene, bird, body, ELASTICITY,
-                                     state);
-        break;
-      case GROUND:
-        create_ground_wall_collision(state->scene, bird, body, ELASTICITY,
-                                     state);
-        break;
-      default:
-        break;
-      }
-    }
-  }
+void add_layer_handlers(state_t *state) {
+  scene_set_layer_handler(state->scene, PROJECTILE, ENEMY,
+                          (collision_handler_t)pig_bird_collision_handler,
+                          state, ELASTICITY);
+  scene_set_layer_handler(state->scene, PROJECTILE, WALL,
+                          (collision_handler_t)ground_wall_collision_handler,
+                          state, ELASTICITY);
+  scene_set_layer_handler(state->scene, PROJECTILE, GROUND,
+                          (collision_handler_t)ground_wall_collision_handler,
+                          state, ELASTICITY);
 }
 
-void make_birds_enemies_forces(state_t *state) {
+void make_birds_enemies(state_t *state) {
   for (size_t i = 0; i < NUM_BIRDS; i++) {
     make_bird(state, BIRD_MASS, white, free, BIRD_START_LOC, true);
   }
@@ -330,7 +294,6 @@ void make_birds_enemies_forces(state_t *state) {
     vector_t loc = enem_locs[i];
     make_enemy(state, ENEMY_HEALTH, ENEMY_MASS, free, loc);
   }
-  add_force_creators(state);
 }
 
 void reset_play(state_t *state, bool mouse_type, double x, double y) {
@@ -352,7 +315,7 @@ void reset_play(state_t *state, bool mouse_type, double x, double y) {
     list_remove(state->enemies, i);
   }
 
-  make_birds_enemies_forces(state);
+  make_birds_enemies(state);
 }
 
 asset_t *create_sling_button(state_t *state, SDL_Rect box,
@@ -407,7 +370,7 @@ state_t *emscripten_init() {
   sdl_init(MIN, MAX);
   state_t *state = malloc(sizeof(state_t));
   state->points = 0;
-  state->scene = scene_init();
+  state->scene = scene_init_with_broadphase(BROADPHASE_TREE);
   state->body_assets = list_init(1, (free_func_t)asset_destroy);
   state->button_assets = list_init(NUM_BUTTONS, (free_func_t)asset_destroy);
   state->birds = list_init(NUM_BIRDS, (free_func_t)asset_destroy);
@@ -437,14 +400,17 @@ state_t *emscripten_init() {
   state->reset_button =
       create_reset_button(state, RESET_BOX, REPLAY_BUTTON_PATH);
 
+  state->wood_prototype = body_init(
+      make_rectangle(MIN, WOOD_WIDTH, WOOD_HEIGHT), ENEMY_MASS, white);
   for (size_t i = 0; i < NUM_WOOD; i++) {
     vector_t loc = wood_locs[i];
     make_wood(state, ENEMY_MASS, white, loc);
   }
 
   add_walls(state);
+  add_layer_handlers(state);
 
-  make_birds_enemies_forces(state);
+  make_birds_enemies(state);
   sdl_play_music((char *)SONG);
 
   return state;
@@ -520,6 +486,7 @@ void emscripten_free(state_t *state) {
   list_free(state->walls);
   list_free(state->shot_marker);
   body_free(state->ground);
+  body_free(state->wood_prototype);
   scene_free(state->scene);
   asset_cache_destroy();
   free(state);
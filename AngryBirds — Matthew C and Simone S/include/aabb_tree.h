@@ -0,0 +1,104 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include "body.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A dynamic bounding volume hierarchy over axis-aligned bounding boxes.
+ * Each leaf holds a box and a value (e.g. the index of a body). Internal
+ * nodes hold the union of their children's boxes, so a query only descends
+ * into the parts of the tree its box overlaps.
+ * The tree is rebalanced as leaves are inserted and removed, so queries stay
+ * logarithmic however the leaves are added.
+ */
+typedef struct aabb_tree aabb_tree_t;
+
+/**
+ * A function called on the value of each leaf found by aabb_tree_query().
+ * Takes in an auxiliary value that can store parameters or state.
+ */
+typedef void (*aabb_tree_query_func_t)(size_t value, void *aux);
+
+/**
+ * Allocates memory for an empty tree.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated tree
+ */
+aabb_tree_t *aabb_tree_init(void);
+
+/**
+ * Releases the memory allocated for a tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ */
+void aabb_tree_free(aabb_tree_t *tree);
+
+/**
+ * Adds a leaf to a tree. Where it goes is picked by comparing perimeters, so
+ * the box must be finite, unlike the bounds of a half-plane.
+ * Asserts that the box's perimeter is finite.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param bounds the box of the leaf
+ * @param value the value reported when a query finds the leaf
+ * @return an id for the leaf, valid until it is removed
+ */
+size_t aabb_tree_insert(aabb_tree_t *tree, aabb_t bounds, size_t value);
+
+/**
+ * Removes a leaf from a tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param leaf an id returned from aabb_tree_insert()
+ */
+void aabb_tree_remove(aabb_tree_t *tree, size_t leaf);
+
+/**
+ * Gets the box a leaf was inserted with.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param leaf an id returned from aabb_tree_insert()
+ * @return the leaf's box
+ */
+aabb_t aabb_tree_get_bounds(aabb_tree_t *tree, size_t leaf);
+
+/**
+ * Changes the value stored in a leaf.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param leaf an id returned from aabb_tree_insert()
+ * @param value the value reported when a query finds the leaf
+ */
+void aabb_tree_set_value(aabb_tree_t *tree, size_t leaf, size_t value);
+
+/**
+ * Finds every leaf whose box overlaps a given box.
+ * Boxes that only touch count as overlapping, like in aabb_overlap().
+ * func must not change or query the tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param bounds the box to search
+ * @param func a function called on the value of each overlapping leaf
+ * @param aux an auxiliary value passed to func
+ */
+void aabb_tree_query(aabb_tree_t *tree, aabb_t bounds,
+                     aabb_tree_query_func_t func, void *aux);
+
+/**
+ * Finds every leaf whose box a segment passes through,
+ * like aabb_segment_overlap().
+ * func must not change or query the tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param start the start of the segment
+ * @param end the end of the segment
+ * @param func a function called on the value of each leaf the segment crosses
+ * @param aux an auxiliary value passed to func
+ */
+void aabb_tree_query_segment(aabb_tree_t *tree, vector_t start, vector_t end,
+                             aabb_tree_query_func_t func, void *aux);
+
+#endif // #ifndef __AABB_TREE_H__
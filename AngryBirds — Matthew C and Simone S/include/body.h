@@ -2,6 +2,7 @@
 #define __BODY_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "color.h"
 #include "list.h"
@@ -15,6 +16,36 @@ typedef struct body body_t;
 
 typedef struct enemy_body enemy_body_t;
 
+/**
+ * An axis-aligned bounding box, given by its bottom-left and top-right corners.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+/**
+ * A read-only view of a body's vertices, borrowed from the body rather than
+ * copied. It is only valid until the body next moves or turns, or is freed.
+ */
+typedef struct {
+  const vector_t *vertices;
+  size_t num_vertices;
+} vertex_span_t;
+
+/**
+ * The number of collision layers a body can be on (see body_set_layer()),
+ * i.e. the number of bits in a collision mask.
+ */
+extern const size_t NUM_COLLISION_LAYERS;
+
+/**
+ * How far a new body's collision shape may stray from the shape it is drawn
+ * with, as a fraction of its thickness (how far its centroid is from its
+ * nearest edge); see body_set_collision_tolerance().
+ */
+extern const double DEFAULT_COLLISION_ERROR;
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -38,6 +69,86 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer);
 
+/**
+ * Allocates memory for a circular body, like body_init_with_info().
+ * The circle is stored exactly (as a center and radius) rather than as a
+ * polygon, so it collides analytically and moves in constant time.
+ *
+ * @param center the initial center of mass of the body
+ * @param radius the radius of the circle
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body,
+ *   e.g. its type if the scene has multiple types of bodies
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_circle_with_info(vector_t center, double radius, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer);
+
+/**
+ * Allocates memory for a body that is a segment, like body_init_with_info().
+ * A segment is a polygon with two vertices and no thickness, e.g. a ledge,
+ * and costs a single edge normal to collide with.
+ *
+ * @param start one end of the segment
+ * @param end the other end of the segment
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body,
+ *   e.g. its type if the scene has multiple types of bodies
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_segment_with_info(vector_t start, vector_t end, double mass,
+                                    rgb_color_t color, void *info,
+                                    free_func_t info_freer);
+
+/**
+ * Allocates memory for a body that fills everything on one side of a line,
+ * like body_init_with_info(). Half-planes are for the ground and the bounds
+ * of the world: they collide with any body by projecting it on their normal
+ * alone, and since they have no far side, nothing can tunnel through them.
+ * Two half-planes never collide with each other.
+ * The body's centroid is the given point, and its shape (see
+ * body_get_shape()) has no vertices.
+ *
+ * @param point a point on the boundary
+ * @param normal a vector normal to the boundary, facing out of the body
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body
+ * @param info additional information to associate with the body,
+ *   e.g. its type if the scene has multiple types of bodies
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_half_plane_with_info(vector_t point, vector_t normal,
+                                       double mass, rgb_color_t color,
+                                       void *info, free_func_t info_freer);
+
+/**
+ * Allocates memory for a body with the same shape as another, like
+ * body_init_with_info(). The bodies share their shape and the simpler shape
+ * they collide as (see polygon_init_instance()), so a level's identical
+ * blocks can all be made from one prototype body without building and
+ * simplifying a list of vertices for each.
+ * The prototype doesn't need to be in a scene, and may be freed first.
+ *
+ * @param prototype the body whose shape to share
+ * @param centroid the new body's centroid. It is turned as the prototype
+ *   was created.
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body,
+ *   e.g. its type if the scene has multiple types of bodies
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_instance_with_info(body_t *prototype, vector_t centroid,
+                                     double mass, rgb_color_t color,
+                                     void *info, free_func_t info_freer);
+
 enemy_body_t *enemy_body_init(double health, list_t *shape, double mass,
                               rgb_color_t color);
 
@@ -45,6 +156,11 @@ enemy_body_t *enemy_body_init_with_info(double health, list_t *shape,
                                         double mass, rgb_color_t color,
                                         void *info, free_func_t info_freer);
 
+enemy_body_t *enemy_body_init_circle_with_info(double health, vector_t center,
+                                               double radius, double mass,
+                                               rgb_color_t color, void *info,
+                                               free_func_t info_freer);
+
 /**
  * Releases the memory allocated for a body.
  *
@@ -63,12 +179,45 @@ void enemy_subtract_health(body_t *enemy, double minus);
 /**
  * Gets the current shape of a body.
  * Returns a newly allocated vector list, which must be list_free()d.
+ * Circular bodies return a polygon approximating the circle, and half-planes
+ * return an empty list.
+ * Only use this to keep the shape; body_get_vertices() reads it for free.
  *
  * @param body a pointer to a body returned from body_init()
  * @return the polygon describing the body's current position
  */
 list_t *body_get_shape(body_t *body);
 
+/**
+ * Gets the current vertices of a body without copying them (see
+ * vertex_span_t). Circular bodies and half-planes have no vertices; draw
+ * them from body_get_polygon() instead.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return a view of the body's vertices, in order
+ */
+vertex_span_t body_get_vertices(body_t *body);
+
+/**
+ * Gets the kind of shape a body collides as; see body_get_collision_polygon().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return SHAPE_CIRCLE for bodies made with body_init_circle_with_info(),
+ * and for nearly round polygons that collide as circles,
+ * SHAPE_HALF_PLANE for bodies made with body_init_half_plane_with_info(),
+ * otherwise SHAPE_POLYGON
+ */
+shape_type_t body_get_shape_type(body_t *body);
+
+/**
+ * Gets the radius of a body that collides as a circle.
+ * Bodies that collide as polygons have a radius of 0.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's radius
+ */
+double body_get_radius(body_t *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -80,6 +229,20 @@ list_t *body_get_shape(body_t *body);
  */
 vector_t body_get_centroid(body_t *body);
 
+/**
+ * Gets the axis-aligned bounding box of a body's current collision shape.
+ * The box is cached on the body and kept up to date as it moves and rotates,
+ * so this is cheap enough to call on every pair of bodies every tick.
+ * A bullet's box also covers the path it moved along in its last tick,
+ * so whatever it passed through is still checked against it.
+ * A half-plane's box reaches out to +/-__DBL_MAX__ on every side except the
+ * boundary, if the boundary is horizontal or vertical.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smallest axis-aligned box containing the body
+ */
+aabb_t body_get_aabb(body_t *body);
+
 /**
  * Gets the current velocity of a body.
  *
@@ -112,6 +275,116 @@ double body_get_rotation(body_t *body);
  */
 double body_get_mass(body_t *body);
 
+/**
+ * Gets the area of a body's shape, computed when it was created.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's area, or INFINITY for a half-plane
+ */
+double body_get_area(body_t *body);
+
+/**
+ * Gets a body's moment of inertia about its centroid, computed when it was
+ * created from its shape and mass (see polygon_moment_of_inertia()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's moment of inertia, or INFINITY for a static body
+ */
+double body_get_moment_of_inertia(body_t *body);
+
+/**
+ * Determines whether a body is static, i.e. has infinite mass (a mass of
+ * INFINITY or __DBL_MAX__), like the walls and blocks of a level.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body's mass is infinite
+ */
+bool body_is_static(body_t *body);
+
+/**
+ * Marks a body as a bullet, i.e. fast enough to pass through thin bodies
+ * within a single tick. Collisions with bullets check the whole path they
+ * moved along during the tick, not just where they ended up.
+ * Bodies are not bullets by default.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param bullet whether the body is a bullet
+ */
+void body_set_bullet(body_t *body, bool bullet);
+
+/**
+ * Determines whether a body is a bullet; see body_set_bullet().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a bullet
+ */
+bool body_is_bullet(body_t *body);
+
+/**
+ * Puts a body on a collision layer. Scenes look up what to do when two
+ * bodies collide by their layers (see scene_set_layer_handler()).
+ * Bodies start on layer 0.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param layer the layer, less than NUM_COLLISION_LAYERS
+ */
+void body_set_layer(body_t *body, size_t layer);
+
+/**
+ * Gets the collision layer a body is on; see body_set_layer().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's layer
+ */
+size_t body_get_layer(body_t *body);
+
+/**
+ * Sets which layers a body can collide with: bit i of the mask is set if
+ * the body collides with bodies on layer i. Two bodies are only checked
+ * for layer collisions if each one's mask has the other's layer.
+ * Bodies start with every bit set.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param mask the body's collision mask
+ */
+void body_set_mask(body_t *body, uint32_t mask);
+
+/**
+ * Gets which layers a body can collide with; see body_set_mask().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's collision mask
+ */
+uint32_t body_get_mask(body_t *body);
+
+/**
+ * Determines whether two bodies' layers and masks let them collide.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether each body's mask has the other's layer
+ */
+bool body_layers_collide(body_t *body1, body_t *body2);
+
+/**
+ * Gets how far a body moved during its last body_tick().
+ * Moving the body by hand (e.g. with body_set_centroid()) resets this to 0.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the translation of the body's centroid over the last tick
+ */
+vector_t body_get_motion(body_t *body);
+
+/**
+ * Moves a body back along the path of its last tick, to where it was
+ * partway through the tick, e.g. to when it first hit another body.
+ * The body's motion is shortened to end there, and its velocity is unchanged.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param time the fraction of the tick to go back to, between 0 and 1
+ */
+void body_rewind(body_t *body, double time);
+
 /**
  * Gets the polygon object associated with the body
  * @param body a pointer to a body returned from body_init()
@@ -119,6 +392,30 @@ double body_get_mass(body_t *body);
  */
 polygon_t *body_get_polygon(body_t *body);
 
+/**
+ * Gets the shape a body collides as. This is a simplified proxy for the
+ * polygon it is drawn with, built by polygon_simplify() when the body is
+ * created, so collisions cost as much as the proxy has vertices rather than
+ * as much as the art has. The body's own polygon is returned when it can't
+ * be simplified. The proxy moves and turns with the body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return a pointer to the polygon_t struct to collide with
+ */
+polygon_t *body_get_collision_polygon(body_t *body);
+
+/**
+ * Rebuilds a body's collision shape from its current polygon, letting its
+ * boundary be up to a given distance from the polygon's.
+ * Bodies are created with a tolerance of DEFAULT_COLLISION_ERROR times
+ * their thickness; a tolerance of 0 only drops vertices in the middle of
+ * edges.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param tolerance how far the collision shape may stray from the polygon
+ */
+void body_set_collision_tolerance(body_t *body, double tolerance);
+
 /**
  * Return the info associated with a body.
  *
@@ -197,6 +494,16 @@ void body_add_force(body_t *body, vector_t force);
  */
 void body_add_impulse(body_t *body, vector_t impulse);
 
+/**
+ * Gets the velocity a body will have after its next tick, from the forces
+ * and impulses applied to it so far (see body_tick()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the length of the next tick, in seconds
+ * @return the velocity body_tick() would give the body
+ */
+vector_t body_get_next_velocity(body_t *body, double dt);
+
 /**
  * Clear the forces and impulses on the body.
  *
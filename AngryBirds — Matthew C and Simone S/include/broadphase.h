@@ -0,0 +1,134 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+
+/**
+ * A broadphase finds the pairs of bodies whose bounding boxes overlap,
+ * so the (much more expensive) narrowphase only runs on bodies that are
+ * actually close to each other.
+ */
+typedef struct broadphase broadphase_t;
+
+/**
+ * The ways a broadphase can organize its bodies.
+ */
+typedef enum {
+  /**
+   * Bodies are bucketed into a uniform grid of square cells, keyed on their
+   * axis-aligned bounds and stored in a spatial hash, so only bodies sharing
+   * a cell are compared.
+   */
+  BROADPHASE_GRID,
+  /**
+   * The ends of the bodies' bounds on the x axis are kept sorted between
+   * updates, so only bodies whose x intervals overlap are compared.
+   * Bodies barely move between ticks, so re-sorting is close to linear.
+   */
+  BROADPHASE_SWEEP_AND_PRUNE,
+  /**
+   * Bodies are kept in two dynamic bounding volume hierarchies, one for
+   * static bodies (see body_is_static()) and one for moving bodies.
+   * Moving bodies are stored with padded bounds, so the tree only changes
+   * when a body leaves its padding. Pairs of two static bodies are never
+   * reported, so levels can hold many static pieces cheaply.
+   * Half-planes, whose bounds have no size, are kept out of the trees and
+   * checked against every body.
+   */
+  BROADPHASE_TREE
+} broadphase_type_t;
+
+/**
+ * Allocates memory for an empty grid broadphase.
+ * Asserts that the required memory is allocated.
+ *
+ * @param cell_size the side length of a grid cell. This should be around the
+ *   size of a typical moving body.
+ * @return a pointer to the newly allocated broadphase
+ */
+broadphase_t *broadphase_init(double cell_size);
+
+/**
+ * Allocates memory for an empty sweep-and-prune broadphase.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated broadphase
+ */
+broadphase_t *broadphase_init_sweep_and_prune(void);
+
+/**
+ * Allocates memory for an empty tree broadphase.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated broadphase
+ */
+broadphase_t *broadphase_init_tree(void);
+
+/**
+ * Releases the memory allocated for a broadphase.
+ * Does not free any bodies.
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ */
+void broadphase_free(broadphase_t *broadphase);
+
+/**
+ * Rebuilds the broadphase from the current positions of a list of bodies
+ * and recomputes the candidate pairs.
+ * Bodies may be added to or removed from the list between updates.
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ * @param bodies the bodies to check against each other
+ */
+void broadphase_update(broadphase_t *broadphase, list_t *bodies);
+
+/**
+ * Gets the number of candidate pairs found by the last broadphase_update().
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ * @return the number of pairs of bodies with overlapping bounds
+ */
+size_t broadphase_num_pairs(broadphase_t *broadphase);
+
+/**
+ * Gets a candidate pair found by the last broadphase_update().
+ * Pairs are ordered by the index of their bodies in the list passed to
+ * broadphase_update(), and body1 always comes before body2 in that list,
+ * so the order does not depend on how the bodies are laid out in space.
+ * Asserts that the index is valid.
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ * @param index the index of the pair (starting at 0)
+ * @return the pair at the given index
+ */
+pair_t broadphase_get_pair(broadphase_t *broadphase, size_t index);
+
+/**
+ * Finds the bodies whose bounds overlap a box, using the bounds they had at
+ * the last broadphase_update(). Boxes that only touch count as overlapping.
+ * The bodies are added to the list in the order they were passed to
+ * broadphase_update(). Never allocates once the broadphase has grown to its
+ * largest query.
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ * @param bounds the box to search
+ * @param found a list the bodies are added to. It does not own the bodies,
+ *   so its freer should be NULL.
+ */
+void broadphase_query(broadphase_t *broadphase, aabb_t bounds, list_t *found);
+
+/**
+ * Finds the bodies whose bounds a segment passes through, like
+ * broadphase_query().
+ *
+ * @param broadphase a pointer to a broadphase returned from broadphase_init()
+ * @param start the start of the segment
+ * @param end the end of the segment
+ * @param found a list the bodies are added to
+ */
+void broadphase_query_segment(broadphase_t *broadphase, vector_t start,
+                              vector_t end, list_t *found);
+
+#endif // #ifndef __BROADPHASE_H__
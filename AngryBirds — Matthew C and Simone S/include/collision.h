@@ -17,13 +17,206 @@ typedef struct {
    * If the shapes are colliding, the axis they are colliding on.
    * This is a unit vector pointing from the first shape towards the second.
    * Normal impulses are applied along this axis.
-   * If collided is false, this value is undefined.
+   * If collided is false, this is either VEC_ZERO or a unit axis that
+   * separates the shapes, which can be cached (see separating_axis_t).
    */
   vector_t axis;
 } collision_info_t;
 
+/**
+ * Where two colliding bodies touch, e.g. to resolve a resting contact.
+ * Two convex shapes touch at a single point or along a segment, so at most
+ * two points (the ends of the segment) are needed.
+ */
+typedef struct {
+  /** The unit axis the bodies collide on, from the first towards the second */
+  vector_t normal;
+  /** How far the bodies overlap along the normal, at the deepest point */
+  double depth;
+  /** The number of contact points, from 0 (not touching) to 2 */
+  size_t num_points;
+  /** The contact points, each midway between the bodies' surfaces */
+  vector_t points[2];
+  /** How far the bodies overlap along the normal at each contact point */
+  double depths[2];
+} contact_manifold_t;
+
+/**
+ * Where a segment first enters a body, e.g. for a raycast.
+ */
+typedef struct {
+  /** The body the segment hits */
+  body_t *body;
+  /** How far along the segment the hit is, from 0 at its start to 1 */
+  double fraction;
+  /** The point where the segment enters the body */
+  vector_t point;
+  /** The unit normal of the body's surface at the point, facing out */
+  vector_t normal;
+} ray_hit_t;
+
+/**
+ * The algorithms find_collision_with() can use to test a pair of bodies.
+ */
+typedef enum {
+  /**
+   * The separating axis test of find_collision(). Every edge normal of both
+   * polygons is tried, projecting every vertex onto each, and circles are
+   * handled analytically.
+   */
+  NARROWPHASE_SAT,
+  /**
+   * GJK and EPA, as in find_collision_gjk(). Shapes are only read through
+   * their support functions, so every pair of shapes takes the same path.
+   */
+  NARROWPHASE_GJK
+} narrowphase_type_t;
+
+/**
+ * Two bodies that may be colliding, e.g. a candidate pair from a broadphase.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+} pair_t;
+
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision(), or the body on
+ *   the first layer passed to scene_set_layer_handler()
+ * @param body2 the second body passed to create_collision(), or the body on
+ *   the second layer passed to scene_set_layer_handler()
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value passed with the handler
+ * @param force_const the force constant passed with the handler
+ */
+/* typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t
+   axis, void *aux, double force_const, void *state); */
+typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                                    void *aux, double force_const);
+
+/**
+ * A collision found during a tick, queued so its handler can run after
+ * every pair has been tested (see scene_add_collision_event()).
+ */
+typedef struct {
+  /** The first body, passed first to the handler */
+  body_t *body1;
+  /** The second body */
+  body_t *body2;
+  /** The unit axis the bodies collide on, from body1 towards body2 */
+  vector_t axis;
+  /** How far the bodies overlap along the axis */
+  double depth;
+  /** The velocity of body2 relative to body1 when they collided */
+  vector_t relative_velocity;
+  /** The handler to call, or NULL to only record the collision */
+  collision_handler_t handler;
+  /** The auxiliary value to pass to the handler */
+  void *aux;
+  /** The force constant to pass to the handler */
+  double force_const;
+} collision_event_t;
+
+/**
+ * A contact that a physics collision keeps from sinking in, queued during a
+ * tick so every contact is solved together (see scene_add_contact()).
+ */
+typedef struct {
+  /** The first body */
+  body_t *body1;
+  /** The second body */
+  body_t *body2;
+  /** Where the bodies touch, with the normal from body1 towards body2 */
+  contact_manifold_t manifold;
+  /** How much of the bodies' closing speed they bounce back with */
+  double restitution;
+  /**
+   * The impulse at each contact point, kept by the contact's owner from one
+   * tick to the next. It starts as last tick's impulse, and the solver
+   * leaves this tick's impulse in it.
+   */
+  double *impulses;
+} contact_constraint_t;
+
+/**
+ * The axis that last separated a pair of bodies, kept by whatever tests the
+ * pair from one tick to the next (see find_collision_cached()).
+ * Most pairs stay apart for many ticks in a row, and the axis that separated
+ * them last tick usually still does, so trying it first costs one projection
+ * of each body instead of the whole narrowphase.
+ */
+typedef struct {
+  /** Whether axis holds an axis that separated the pair */
+  bool valid;
+  /** The unit separating axis */
+  vector_t axis;
+} separating_axis_t;
+
+/**
+ * Counts how often cached separating axes were tried, and how often they
+ * still separated their pair, to measure the hit rate on a level.
+ */
+typedef struct {
+  /** The number of tests that had a cached axis to try */
+  size_t tests;
+  /** The number of those tests where the axis still separated the pair */
+  size_t hits;
+} axis_cache_stats_t;
+
+/**
+ * Determines whether two axis-aligned bounding boxes overlap.
+ * Boxes that only touch count as overlapping, like touching shapes do in
+ * find_collision().
+ *
+ * @param aabb1 the first box
+ * @param aabb2 the second box
+ * @return whether the boxes overlap
+ */
+bool aabb_overlap(aabb_t aabb1, aabb_t aabb2);
+
+/**
+ * Determines whether a segment passes through an axis-aligned bounding box.
+ * Segments that only touch the box count, like in aabb_overlap().
+ *
+ * @param aabb the box
+ * @param start the start of the segment
+ * @param end the end of the segment
+ * @return whether any point of the segment is in the box
+ */
+bool aabb_segment_overlap(aabb_t aabb, vector_t start, vector_t end);
+
+/**
+ * Determines whether a point is inside a body's shape.
+ * Points on the boundary count as inside.
+ *
+ * @param body the body
+ * @param point the point
+ * @return whether the body contains the point
+ */
+bool point_in_body(body_t *body, vector_t point);
+
+/**
+ * Finds where a segment first enters a body, without allocating.
+ * Segments that start inside the body don't hit it, so a ray cast from
+ * inside a body finds what is beyond it.
+ *
+ * @param body the body
+ * @param start the start of the segment
+ * @param end the end of the segment
+ * @param hit set to where the segment hits the body, if it does
+ * @return whether the segment hits the body
+ */
+bool find_ray_hit(body_t *body, vector_t start, vector_t end, ray_hit_t *hit);
+
 /**
  * Computes the status of the collision between two bodies.
+ * Reads the bodies' vertices in place and never allocates memory,
+ * so it is cheap enough to call on every candidate pair every tick.
+ * Bodies whose bounding boxes do not overlap are rejected without looking
+ * at their vertices. Circular bodies are tested analytically from their
+ * center and radius.
  *
  * @param body1 the first body
  * @param body2 the second body
@@ -32,4 +225,137 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * Computes the status of the collision between each of an array of pairs of
+ * bodies, exactly like calling find_collision() on each pair in turn.
+ * The pairs are grouped by the kernel their shapes need (e.g. box-box or
+ * circle-polygon), so each kernel runs over its pairs back to back, and the
+ * vertices of upcoming pairs are prefetched while earlier ones are tested.
+ * This is the entry point to feed with a broadphase's candidate pairs.
+ * Never allocates memory.
+ *
+ * @param pairs the pairs of bodies
+ * @param num_pairs the number of pairs
+ * @param out set to the result for each pair, in the same order
+ */
+void find_collisions_batch(const pair_t *pairs, size_t num_pairs,
+                           collision_info_t *out);
+
+/**
+ * Computes the status of the collision between two bodies, like
+ * find_collision(), using the Gilbert-Johnson-Keerthi algorithm.
+ * Each body is only read through its support function, the point of it
+ * furthest along a direction: a vertex for polygons, and the center plus
+ * the radius along the direction for circles. GJK searches the Minkowski
+ * difference of the bodies for the origin using a triangle of support
+ * points, and if it is inside, the expanding polytope algorithm (EPA)
+ * grows the triangle out to the difference's edge nearest the origin,
+ * which gives the collision axis.
+ * Axes between circles are only exact to within a small tolerance, and
+ * shapes that exactly touch may be reported either way.
+ * Never allocates memory.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * a unit vector pointing from body1 towards body2
+ */
+collision_info_t find_collision_gjk(body_t *body1, body_t *body2);
+
+/**
+ * Computes the status of the collision between two bodies with the given
+ * narrowphase: find_collision() for NARROWPHASE_SAT, and
+ * find_collision_gjk() for NARROWPHASE_GJK.
+ *
+ * @param type the narrowphase to use
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+collision_info_t find_collision_with(narrowphase_type_t type, body_t *body1,
+                                     body_t *body2);
+
+/**
+ * Computes where two colliding bodies touch.
+ * Polygons are clipped against each other: the edge facing most along the
+ * collision axis is the reference edge, and the other body's edge facing
+ * it is clipped to the reference edge's sides, keeping the points behind it.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param collision the collision between the bodies from find_collision()
+ * @return the bodies' contact points, with none if they are not colliding
+ */
+contact_manifold_t find_contacts(body_t *body1, body_t *body2,
+                                 collision_info_t collision);
+
+/**
+ * Describes a collision between two bodies as an event, with no handler.
+ * The depth comes from find_contacts().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param collision the collision between the bodies from find_collision()
+ * @return the event
+ */
+collision_event_t find_collision_event(body_t *body1, body_t *body2,
+                                       collision_info_t collision);
+
+/**
+ * Finds when two bodies first touched during their last tick, for bodies
+ * fast enough to pass through each other between ticks (see
+ * body_set_bullet()). Each body is taken to have moved in a straight line
+ * by body_get_motion() without rotating, and the first contact along that
+ * path is found exactly.
+ * Bodies that already overlapped at the start of the tick are not reported,
+ * since find_collision() saw them on the tick before.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param time set to the fraction of the tick (between 0 and 1) at which
+ * the bodies first touched, if they did
+ * @return whether the bodies touched during the tick, and if so, the
+ * collision axis at that time, pointing from body1 towards body2
+ */
+collision_info_t find_time_of_impact(body_t *body1, body_t *body2,
+                                     double *time);
+
+/**
+ * Computes the status of the collision between two bodies with the given
+ * narrowphase, trying the axis that separated them last time first.
+ * If it still separates them, the narrowphase is skipped; otherwise the
+ * narrowphase runs, and the axis it finds separating them, if any, is
+ * cached for next time.
+ *
+ * @param type the narrowphase to use
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param cache the pair's cached separating axis, updated by the test
+ * @param stats if non-NULL, counts whether the cached axis was a hit
+ * @return whether the bodies are colliding, and if so, the collision axis
+ */
+collision_info_t find_collision_cached(narrowphase_type_t type, body_t *body1,
+                                       body_t *body2, separating_axis_t *cache,
+                                       axis_cache_stats_t *stats);
+
+/**
+ * Computes whether two bodies collided during the last tick, as collision
+ * force creators check them: bodies whose boxes miss are skipped, the rest
+ * are tested with the given narrowphase, and if either body is a bullet,
+ * with find_time_of_impact() too. If a bullet passed through the other
+ * body, both bodies are moved back to where they first touched
+ * (see body_rewind()).
+ *
+ * @param type the narrowphase to use
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param cache if non-NULL, the pair's cached separating axis, tried before
+ * the narrowphase as in find_collision_cached()
+ * @param stats if non-NULL, counts the cache's hits
+ * @return whether the bodies collided, and if so, the collision axis
+ */
+collision_info_t find_collision_swept(narrowphase_type_t type, body_t *body1,
+                                      body_t *body2, separating_axis_t *cache,
+                                      axis_cache_stats_t *stats);
+
 #endif // #ifndef __COLLISION_H__
@@ -8,20 +8,6 @@ typedef struct body_aux body_aux_t;
 
 void body_aux_free(void *aux);
 
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- * @param force_const the force constant passed to create_collision()
- */
-/* typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t
-   axis, void *aux, double force_const, void *state); */
-typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
-                                    void *aux, double force_const);
-
 /**
  * Adds a force creator to a scene that applies gravity between two bodies.
  * The force creator will be called each tick
@@ -78,6 +64,15 @@ void create_drag_list(scene_t *scene, double gamma, list_t *bodies);
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
+ * The collision is registered with scene_add_pair_force_creator(), so it is
+ * only checked on ticks where the scene's broadphase finds the bodies close,
+ * and then tested with the scene's narrowphase (see scene_set_narrowphase()).
+ * If either body is a bullet (see body_set_bullet()), a collision partway
+ * through the tick is caught too, and both bodies are moved back to where
+ * they first touched before the handler is called.
+ * The handler isn't called straight away: the collision is queued as an
+ * event (see scene_add_collision_event()) and handled once every pair has
+ * been checked for the tick.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -114,13 +109,14 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 /**
  * Adds a force creator to a scene that applies impulses
  * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
+ * Either body may have mass INFINITY, as this is useful for simulating walls.
  *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * The bodies bounce on the tick they first touch. While they keep touching,
+ * the impulses only stop them moving into each other, and they are pushed
+ * apart if they overlap too far, so bodies can rest on each other.
+ * The contacts are solved together with the tick's other physics collisions
+ * (see solve_contacts()), so a stack of bodies holds up its top.
+ * Like create_collision(), bullets are moved back to where they first touched.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -131,4 +127,24 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
                               double elasticity);
 
+/**
+ * Solves the contacts queued during a tick (see scene_add_contact()) so that
+ * none of them is left closing after the bodies' next tick, then pushes
+ * apart bodies that overlap too far. scene_tick() calls this once its pair
+ * force creators have run.
+ *
+ * The velocities are solved with sequential impulses: each contact point
+ * starts from the impulse it had last tick (warm starting), then every
+ * contact is corrected in turn, over a fixed number of passes, so pushes
+ * are passed along chains of contacts like stacks. Each tick starting from
+ * the last one's answer means a stack that would take many passes to solve
+ * from nothing only needs its changes corrected.
+ *
+ * @param contacts the contacts to solve; their impulses are updated
+ * @param num_contacts the number of contacts
+ * @param dt the length of the bodies' next tick, in seconds
+ */
+void solve_contacts(contact_constraint_t *contacts, size_t num_contacts,
+                    double dt);
+
 #endif // #ifndef __FORCES_H__
@@ -76,4 +76,20 @@ void *list_remove(list_t *list, size_t index);
  */
 void list_add(list_t *list, void *value);
 
+/**
+ * A function that orders two list elements for list_sort().
+ * Like the comparator passed to qsort(), it is given pointers to the elements
+ * (i.e. two void ** values) and returns a negative number, zero, or a positive
+ * number if the first element belongs before, with, or after the second.
+ */
+typedef int (*compare_func_t)(const void *, const void *);
+
+/**
+ * Sorts the elements of a list in place.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param compare the function that orders two elements
+ */
+void list_sort(list_t *list, compare_func_t compare);
+
 #endif // #ifndef __LIST_H__
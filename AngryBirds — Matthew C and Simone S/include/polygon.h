@@ -7,8 +7,22 @@
 
 typedef struct polygon polygon_t;
 
+/**
+ * The kinds of shape a polygon_t can hold.
+ * SHAPE_POLYGON is a convex polygon given by its list of vertices. A polygon
+ * with two vertices is a segment, which has no area.
+ * SHAPE_CIRCLE is an exact circle given by its center and radius. It has no
+ * vertices, so its area, centroid and collisions are computed analytically.
+ * SHAPE_HALF_PLANE is everything on one side of a line, given by a point on
+ * the line and the line's normal. It has no vertices either, and is meant for
+ * the ground and the bounds of the world, which nothing can pass through.
+ */
+typedef enum { SHAPE_POLYGON, SHAPE_CIRCLE, SHAPE_HALF_PLANE } shape_type_t;
+
 /**
  * Initialize a polygon object given a list of vertices.
+ * The vertices are copied into one array belonging to the polygon, and the
+ * list is freed, so it must not be used afterwards.
  *
  * @param points the list of vertices that make up the polygon
  * @param initial_position a vector representing the initial center position of
@@ -27,12 +41,196 @@ polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
                         double blue);
 
 /**
- * Return the list of vectors representing the vertices of the polygon.
+ * Initialize a circle-shaped polygon object.
+ * The circle has no vertices; polygon_get_num_vertices() returns 0.
+ *
+ * @param center the center of the circle
+ * @param radius the radius of the circle
+ * @param initial_velocity a vector representing the initial velocity of the
+ * circle
+ * @param rotation_speed the rotation angle of the circle per unit time
+ * @param red double value between 0 and 1 representing the red of the circle
+ * @param green double value between 0 and 1 representing the green of the
+ * circle
+ * @param blue double value between 0 and 1 representing the blue of the circle
+ * @return a polygon object pointer
+ */
+polygon_t *polygon_init_circle(vector_t center, double radius,
+                               vector_t initial_velocity, double rotation_speed,
+                               double red, double green, double blue);
+
+/**
+ * Initialize a half-plane-shaped polygon object: every point p with
+ * dot(p - point, normal) <= 0. The half-plane has no vertices, and its one
+ * normal (see polygon_get_normals()) is its unit normal, which turns as the
+ * half-plane rotates. Its center and centroid are the given point, and its
+ * area is INFINITY.
+ *
+ * @param point a point on the half-plane's boundary
+ * @param normal a vector normal to the boundary, facing out of the half-plane
+ * @param initial_velocity a vector representing the initial velocity of the
+ * half-plane
+ * @param rotation_speed the rotation angle of the half-plane per unit time
+ * @param red double value between 0 and 1 representing the red of the
+ * half-plane
+ * @param green double value between 0 and 1 representing the green of the
+ * half-plane
+ * @param blue double value between 0 and 1 representing the blue of the
+ * half-plane
+ * @return a polygon object pointer
+ */
+polygon_t *polygon_init_half_plane(vector_t point, vector_t normal,
+                                   vector_t initial_velocity,
+                                   double rotation_speed, double red,
+                                   double green, double blue);
+
+/**
+ * Initialize a polygon with the same shape as another, e.g. one of many
+ * identical blocks. The polygons share their vertices and normals as they
+ * were created, and everything computed from them, so this does no work
+ * per vertex beyond allocating the new polygon's own copy of them in the
+ * world. Each polygon moves on its own, and either may be freed first.
+ *
+ * @param prototype the polygon whose shape to share
+ * @param center the new polygon's centroid (a point on the boundary, for a
+ * half-plane). The polygon is turned as the prototype was created.
+ * @param initial_velocity a vector representing the initial velocity of the
+ * polygon
+ * @param rotation_speed the rotation angle of the polygon per unit time
+ * @param red double value between 0 and 1 representing the red of the polygon
+ * @param green double value between 0 and 1 representing the green of the
+ * polygon
+ * @param blue double value between 0 and 1 representing the blue of the polygon
+ * @return a polygon object pointer
+ */
+polygon_t *polygon_init_instance(polygon_t *prototype, vector_t center,
+                                 vector_t initial_velocity,
+                                 double rotation_speed, double red,
+                                 double green, double blue);
+
+/**
+ * Builds a simpler convex shape whose boundary is within a tolerance of a
+ * polygon's everywhere, to collide with in its place. Nearly round polygons
+ * become exact circles about their centroid; others lose the vertices that
+ * stray least from the edge that would replace them, down to a triangle.
+ *
+ * @param polygon a convex polygon_t struct
+ * @param tolerance how far the new boundary may be from the polygon's
+ * @return a newly allocated polygon, to be polygon_free()d, or NULL if the
+ * polygon has no vertices or none can be dropped within the tolerance
+ */
+polygon_t *polygon_simplify(polygon_t *polygon, double tolerance);
+
+/**
+ * Returns the kind of shape the polygon holds.
+ *
+ * @param polygon a polygon_t struct
+ * @return SHAPE_CIRCLE for circles made with polygon_init_circle(),
+ * SHAPE_HALF_PLANE for half-planes made with polygon_init_half_plane(),
+ * otherwise SHAPE_POLYGON
+ */
+shape_type_t polygon_get_type(polygon_t *polygon);
+
+/**
+ * Returns the radius of a circle. Polygons have a radius of 0.
+ *
+ * @param polygon a polygon_t struct
+ * @return the radius of the circle
+ */
+double polygon_get_radius(polygon_t *polygon);
+
+/**
+ * Return the vertices of the polygon, in order, packed in one array.
+ * A polygon only keeps its vertices as they were when it was created, plus
+ * its pose: where its centroid is and how far it has turned since. Moving it
+ * only changes the pose, and the vertices in the world are brought up to
+ * date here, the first time they are asked for after it moved.
+ * The array belongs to the polygon and changes when it is moved.
  *
  * @param polygon the list of vertices that make up the polygon
- * @return a list of vectors
+ * @return an array of polygon_get_num_vertices() vectors
+ */
+const vector_t *polygon_get_vertices(polygon_t *polygon);
+
+/**
+ * Return the number of vertices of the polygon: 0 for circles and
+ * half-planes, and 2 for segments.
+ *
+ * @param polygon the polygon
+ * @return the number of vertices returned by polygon_get_vertices()
+ */
+size_t polygon_get_num_vertices(polygon_t *polygon);
+
+/**
+ * Brings the polygon's vertices in the world (see polygon_get_vertices()) up
+ * to date with its pose, if it has moved since they last were.
+ * Reading the vertices of a polygon that has moved writes to it, so this
+ * must be called first when several threads read it at once.
+ *
+ * @param polygon the polygon
+ */
+void polygon_update_vertices(polygon_t *polygon);
+
+/**
+ * Return the number of distinct edge normals of the polygon.
+ * Parallel edges (e.g. opposite sides of a rectangle) share one normal,
+ * and circles have none. A segment also has the axis along it, and a
+ * half-plane has just its own normal.
+ *
+ * @param polygon the polygon
+ * @return the number of normals returned by polygon_get_normals()
  */
-list_t *polygon_get_points(polygon_t *polygon);
+size_t polygon_get_num_normals(polygon_t *polygon);
+
+/**
+ * Return the distinct unit edge normals of the polygon, in its current
+ * orientation. They are computed once when the polygon is created and
+ * rotated along with it, so reading them does no work.
+ * The array belongs to the polygon and changes when it is rotated.
+ *
+ * @param polygon the polygon
+ * @return an array of polygon_get_num_normals() unit vectors
+ */
+const vector_t *polygon_get_normals(polygon_t *polygon);
+
+/**
+ * Return whether the polygon is a rectangle, e.g. a wall or a block of wood,
+ * so it can also be described as an oriented box: a center, the two axes of
+ * polygon_get_normals() and a half-extent along each.
+ *
+ * @param polygon the polygon
+ * @return whether the polygon has four vertices at right angles
+ */
+bool polygon_is_box(polygon_t *polygon);
+
+/**
+ * Return how far a rectangle reaches from its center along each of its two
+ * normals (see polygon_get_normals()). They don't change as it moves.
+ *
+ * @param polygon a polygon for which polygon_is_box() is true
+ * @return the half-extents along the first normal (x) and the second (y)
+ */
+vector_t polygon_get_half_extents(polygon_t *polygon);
+
+/**
+ * Return the x coordinates of the polygon's vertices, packed in the same
+ * order as polygon_get_vertices(), for project_points().
+ * The array belongs to the polygon and changes when it is moved, so the
+ * vertices should only be changed through the polygon functions.
+ *
+ * @param polygon the polygon
+ * @return an array of polygon_get_num_vertices() coordinates
+ */
+const double *polygon_get_xs(polygon_t *polygon);
+
+/**
+ * Return the y coordinates of the polygon's vertices.
+ * See polygon_get_xs().
+ *
+ * @param polygon the polygon
+ * @return an array of polygon_get_num_vertices() coordinates
+ */
+const double *polygon_get_ys(polygon_t *polygon);
 
 /**
  * Translate and rotate the polygon then update velocity based on gravity.
@@ -56,6 +254,8 @@ double polygon_area(polygon_t *polygon);
 /**
  * Computes the center of mass of a polygon.
  * See https://en.wikipedia.org/wiki/Centroid#Of_a_polygon.
+ * It is only computed when the polygon is created and moved along with it
+ * after that, so this does no work.
  *
  * @param polygon the list of vertices that make up the polygon,
  * listed in a counterclockwise direction. There is an edge between
@@ -64,8 +264,23 @@ double polygon_area(polygon_t *polygon);
  */
 vector_t polygon_centroid(polygon_t *polygon);
 
+/**
+ * Computes the moment of inertia of a polygon of uniform density about its
+ * centroid. It doesn't change as the polygon moves, so it only needs to be
+ * computed once.
+ * See https://en.wikipedia.org/wiki/Second_moment_of_area#Any_polygon.
+ *
+ * @param polygon the polygon
+ * @param mass the polygon's mass
+ * @return the moment of inertia: INFINITY for a half-plane, and that of a
+ * thin rod for a segment
+ */
+double polygon_moment_of_inertia(polygon_t *polygon, double mass);
+
 /**
  * Translates all vertices in a polygon by a given vector.
+ * Only the polygon's pose changes, so this takes the same time however many
+ * vertices it has (see polygon_get_vertices()).
  * Note: mutates the original polygon.
  *
  * @param polygon the list of vertices that make up the polygon
@@ -75,6 +290,8 @@ void polygon_translate(polygon_t *polygon, vector_t translation);
 
 /**
  * Rotates vertices in a polygon by a given angle about a given point.
+ * Like polygon_translate(), this only changes the polygon's pose, though its
+ * normals are rotated right away.
  * Note: mutates the original polygon.
  *
  * @param polygon the list of vertices that make up the polygon
@@ -0,0 +1,43 @@
+#ifndef __PROJECTION_H__
+#define __PROJECTION_H__
+
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * Projects a set of points onto an axis and finds the smallest and largest
+ * projections. This is the inner loop of the separating axis test, so the
+ * points are passed as packed arrays of x and y coordinates (see
+ * polygon_get_xs()) that can be loaded straight into SIMD registers.
+ *
+ * Which kernel runs is picked at compile time: AVX (4 points at a time)
+ * when compiled with -mavx, SSE2 (2 at a time) on other x86-64 builds,
+ * WebAssembly SIMD (2 at a time) when emcc is passed -msimd128, and
+ * project_points_scalar() everywhere else.
+ * Every kernel computes each dot product as x * axis.x + y * axis.y, like
+ * vec_dot(), so they all give exactly the same result.
+ *
+ * @param xs the x coordinates of the points
+ * @param ys the y coordinates of the points
+ * @param num_points the number of points
+ * @param axis the axis to project onto
+ * @return a vector in the form (min, max) of the projections.
+ * With no points, min is __DBL_MAX__ and max is -__DBL_MAX__.
+ */
+vector_t project_points(const double *xs, const double *ys, size_t num_points,
+                        vector_t axis);
+
+/**
+ * Like project_points(), but one point at a time.
+ * Used for the points left over after the last full SIMD register.
+ */
+vector_t project_points_scalar(const double *xs, const double *ys,
+                               size_t num_points, vector_t axis);
+
+/**
+ * Returns the name of the kernel project_points() uses,
+ * e.g. "avx", "sse2", "wasm_simd" or "scalar".
+ */
+const char *project_points_kernel(void);
+
+#endif // #ifndef __PROJECTION_H__
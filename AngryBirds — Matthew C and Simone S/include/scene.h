@@ -2,6 +2,8 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "broadphase.h"
+#include "collision.h"
 #include "list.h"
 
 /**
@@ -27,6 +29,98 @@ typedef void (*force_creator_t)(void *aux);
  */
 scene_t *scene_init(void);
 
+/**
+ * Allocates memory for an empty scene, like scene_init(), that finds
+ * colliding pairs with the given kind of broadphase.
+ * scene_init() uses a BROADPHASE_GRID.
+ *
+ * @param type the kind of broadphase to use
+ * @return the new scene
+ */
+scene_t *scene_init_with_broadphase(broadphase_type_t type);
+
+/**
+ * Sets which narrowphase the collisions in a scene (see create_collision())
+ * use to test whether their bodies collide. Takes effect from the next tick.
+ * New scenes use NARROWPHASE_SAT.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the narrowphase to use
+ */
+void scene_set_narrowphase(scene_t *scene, narrowphase_type_t type);
+
+/**
+ * Gets which narrowphase the collisions in a scene use.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the narrowphase set with scene_set_narrowphase()
+ */
+narrowphase_type_t scene_get_narrowphase(scene_t *scene);
+
+/**
+ * Gets the hit-rate counters of the separating axes that the collisions in a
+ * scene (see create_collision() and create_physics_collision()) cache from
+ * one tick to the next (see separating_axis_t).
+ * The counters start at 0 and keep counting across ticks; set them back to 0
+ * to measure a stretch of ticks on their own.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return a pointer to the scene's counters
+ */
+axis_cache_stats_t *scene_get_axis_cache_stats(scene_t *scene);
+
+/**
+ * Sets how many threads a scene splits the narrowphase for its layer
+ * handlers (see scene_set_layer_handler()) between. Each thread tests a
+ * contiguous slice of the pairs found by the broadphase, and the collision
+ * events are queued afterwards in pair order, so the handlers see the same
+ * collisions in the same order whatever the number of threads.
+ * New scenes use 1 thread, i.e. only the thread calling scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param num_threads the number of threads, at least 1
+ */
+void scene_set_num_threads(scene_t *scene, size_t num_threads);
+
+/**
+ * Gets how many threads a scene splits the narrowphase between.
+ * This can be less than was passed to scene_set_num_threads() if the
+ * platform couldn't start that many.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of threads, counting the thread calling scene_tick()
+ */
+size_t scene_get_num_threads(scene_t *scene);
+
+/**
+ * Sets the collision handler for every pair of bodies on two layers
+ * (see body_set_layer()), replacing any handler set on them before.
+ * Each tick, the pairs found by the scene's broadphase are looked up by
+ * their layers, and if the table has a handler and the bodies' masks let
+ * them collide (see body_layers_collide()), the handler is called on the
+ * first tick the bodies collide, like create_collision().
+ * Unlike create_collision(), nothing is registered per pair, so bodies
+ * added later are handled as soon as they are in the scene.
+ *
+ * The handler isn't called straight away: each collision is queued as an
+ * event and handled once every pair has been tested (see
+ * scene_add_collision_event()), so a handler that moves bodies doesn't
+ * change which of the tick's other pairs collide.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param layer1 the layer of the handler's first body
+ * @param layer2 the layer of the handler's second body
+ * @param handler the handler, or NULL for none.
+ *   It is passed the body on layer1 first, with the axis pointing from it
+ *   towards the body on layer2.
+ * @param aux an auxiliary value to pass to the handler.
+ *   The scene does not free it.
+ * @param force_const a constant to pass to the handler
+ */
+void scene_set_layer_handler(scene_t *scene, size_t layer1, size_t layer2,
+                             collision_handler_t handler, void *aux,
+                             double force_const);
+
 /**
  * Releases memory allocated for a given scene
  * and all the bodies and force creators it contains.
@@ -95,10 +189,120 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux);
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies);
 
+/**
+ * Adds a force creator to a scene that only acts while two bodies are close,
+ * e.g. a collision check.
+ * Each tick, the scene's broadphase finds the pairs of bodies whose bounds
+ * overlap, and only the pair force creators registered on those pairs are
+ * invoked, so far-apart pairs cost nothing.
+ * A pair force creator is also invoked once on the first tick after its
+ * bodies stop overlapping, so it can notice that they have separated.
+ * Both bodies must be in the scene. The force creator is removed when either
+ * body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param body1 the first body the force creator acts on
+ * @param body2 the second body the force creator acts on
+ */
+void scene_add_pair_force_creator(scene_t *scene, force_creator_t forcer,
+                                  void *aux, body_t *body1, body_t *body2);
+
+/**
+ * Finds the bodies in a scene whose bounding boxes (see body_get_aabb())
+ * overlap a box, e.g. for an explosion.
+ * Uses the scene's broadphase instead of testing every body, so bodies are
+ * found by where they were at the end of the last scene_tick(), or when
+ * they were added if that was later. Bodies moved by hand since then may
+ * be missed. Bodies marked for removal are skipped.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param bounds the box to search
+ * @param found a list the bodies are added to, in the scene's order.
+ *   It does not own the bodies, so its freer should be NULL.
+ * @return the number of bodies added to found
+ */
+size_t scene_query_aabb(scene_t *scene, aabb_t bounds, list_t *found);
+
+/**
+ * Finds the bodies in a scene whose shapes contain a point, e.g. for
+ * picking a body with the mouse. Points on a body's boundary count.
+ * Bodies are found like in scene_query_aabb().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param point the point
+ * @param found a list the bodies are added to, in the scene's order.
+ *   It does not own the bodies, so its freer should be NULL.
+ * @return the number of bodies added to found
+ */
+size_t scene_query_point(scene_t *scene, vector_t point, list_t *found);
+
+/**
+ * Finds the first body a segment enters, e.g. to preview a trajectory.
+ * Bodies the segment starts inside are ignored (see find_ray_hit()).
+ * Bodies are found like in scene_query_aabb(); with a tree broadphase,
+ * only the branches of the tree the segment crosses are searched.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param start the start of the segment
+ * @param end the end of the segment
+ * @param hit set to the closest hit, if there is one
+ * @return whether the segment hits any body
+ */
+bool scene_raycast(scene_t *scene, vector_t start, vector_t end,
+                   ray_hit_t *hit);
+
+/**
+ * Queues a collision event found during a tick, e.g. by a collision force
+ * creator, instead of calling its handler in the middle of the tick.
+ * Once the tick's pair force creators and layer handlers (see
+ * scene_set_layer_handler()) have run, the handlers of the queued events
+ * are called in one batch, grouped by handler: the groups are in the order
+ * their first event was queued, and each group's events stay in the order
+ * they were queued. Must not be called from a collision handler.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param event the collision, and the handler to call on it (may be NULL)
+ */
+void scene_add_collision_event(scene_t *scene, collision_event_t event);
+
+/**
+ * Queues a contact found during a tick, e.g. by a physics collision force
+ * creator (see create_physics_collision()). Once the tick's pair force
+ * creators have run, the queued contacts are solved together (see
+ * solve_contacts()), before the handlers of the collision events run.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param contact the contact to solve this tick
+ */
+void scene_add_contact(scene_t *scene, contact_constraint_t contact);
+
+/**
+ * Gets the number of collision events queued during the last scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of events
+ */
+size_t scene_num_collision_events(scene_t *scene);
+
+/**
+ * Gets a collision event queued during the last scene_tick(), e.g. to play
+ * a sound for each collision. Its bodies may have been removed by a handler,
+ * but are not freed until the next tick.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the event, in the order they were queued
+ * @return the event
+ */
+collision_event_t scene_get_collision_event(scene_t *scene, size_t index);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
  * and then ticking each body (see body_tick()).
+ * Pair force creators are only executed for pairs found by the broadphase.
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
@@ -78,6 +78,7 @@ void sdl_clear(void);
 
 /**
  * Draws a polygon from the given list of vertices and a color.
+ * Segments are drawn as lines, and half-planes aren't drawn.
  *
  * @param poly a struct representing the polygon
  * @param color the color used to fill in the polygon
@@ -0,0 +1,61 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stddef.h>
+
+/**
+ * A fixed set of worker threads that split loops between them.
+ * The workers are started once and wait between loops, so running a loop
+ * only costs waking them up.
+ */
+typedef struct thread_pool thread_pool_t;
+
+/**
+ * A function that does the work for the indices in [start, end).
+ * It may be called on several threads at once, for disjoint ranges,
+ * so it must only write to data belonging to its own indices.
+ */
+typedef void (*range_func_t)(void *aux, size_t start, size_t end);
+
+/**
+ * Allocates memory for a thread pool and starts its workers.
+ * The thread calling thread_pool_for() works too, so num_threads - 1
+ * workers are started. If the platform can't start threads (e.g. a
+ * WebAssembly build without thread support), the pool starts fewer workers,
+ * down to none, and thread_pool_for() does the rest of the work itself.
+ * Asserts that the required memory is allocated.
+ *
+ * @param num_threads the number of threads to split loops between, at least 1
+ * @return a pointer to the newly allocated thread pool
+ */
+thread_pool_t *thread_pool_init(size_t num_threads);
+
+/**
+ * Gets the number of threads a pool splits loops between,
+ * counting the thread calling thread_pool_for().
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ * @return the number of threads, which may be less than was asked for
+ */
+size_t thread_pool_num_threads(thread_pool_t *pool);
+
+/**
+ * Runs a function over the indices [0, count), split into one contiguous
+ * range per thread in index order, and waits for every range to finish.
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ * @param count the number of indices
+ * @param func the function to run on each range
+ * @param aux an auxiliary value to pass to func
+ */
+void thread_pool_for(thread_pool_t *pool, size_t count, range_func_t func,
+                     void *aux);
+
+/**
+ * Stops the workers of a thread pool and releases its memory.
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ */
+void thread_pool_free(thread_pool_t *pool);
+
+#endif // #ifndef __THREAD_POOL_H__
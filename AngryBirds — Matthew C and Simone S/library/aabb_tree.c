@@ -0,0 +1,378 @@
+#include "aabb_tree.h"
+#include "collision.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t TREE_NULL_NODE = (size_t)-1;
+const size_t TREE_INITIAL_CAPACITY = 16;
+
+/**
+ * A node of the tree. Leaves have no children and hold a value; internal
+ * nodes always have two children. Nodes on the free list reuse `parent` as
+ * the link to the next free node.
+ */
+typedef struct tree_node {
+  aabb_t bounds;
+  size_t parent;
+  size_t child1;
+  size_t child2;
+  size_t height;
+  size_t value;
+} tree_node_t;
+
+struct aabb_tree {
+  tree_node_t *nodes;
+  size_t capacity;
+  size_t root;
+  size_t free_list;
+
+  size_t *stack;
+  size_t stack_capacity;
+};
+
+static aabb_t aabb_union(aabb_t aabb1, aabb_t aabb2) {
+  return (aabb_t){{fmin(aabb1.min.x, aabb2.min.x),
+                   fmin(aabb1.min.y, aabb2.min.y)},
+                  {fmax(aabb1.max.x, aabb2.max.x),
+                   fmax(aabb1.max.y, aabb2.max.y)}};
+}
+
+/**
+ * The cost of a box in the tree. In 2D the chance of a query hitting a box
+ * grows with its perimeter, like it grows with surface area in 3D.
+ */
+static double aabb_perimeter(aabb_t aabb) {
+  return 2 * ((aabb.max.x - aabb.min.x) + (aabb.max.y - aabb.min.y));
+}
+
+static bool node_is_leaf(tree_node_t *node) {
+  return node->child1 == TREE_NULL_NODE;
+}
+
+static size_t max_height(size_t height1, size_t height2) {
+  return height1 > height2 ? height1 : height2;
+}
+
+aabb_tree_t *aabb_tree_init(void) {
+  aabb_tree_t *tree = malloc(sizeof(aabb_tree_t));
+  assert(tree);
+
+  tree->nodes = NULL;
+  tree->capacity = 0;
+  tree->root = TREE_NULL_NODE;
+  tree->free_list = TREE_NULL_NODE;
+  tree->stack = NULL;
+  tree->stack_capacity = 0;
+
+  return tree;
+}
+
+void aabb_tree_free(aabb_tree_t *tree) {
+  free(tree->nodes);
+  free(tree->stack);
+  free(tree);
+}
+
+/**
+ * Takes a node off the free list, growing the node pool if it is empty.
+ * Growing moves the nodes, so pointers to them must be re-read afterwards.
+ */
+static size_t tree_alloc_node(aabb_tree_t *tree) {
+  if (tree->free_list == TREE_NULL_NODE) {
+    size_t old_capacity = tree->capacity;
+    tree->capacity =
+        old_capacity == 0 ? TREE_INITIAL_CAPACITY : 2 * old_capacity;
+    tree->nodes = realloc(tree->nodes, sizeof(tree_node_t) * tree->capacity);
+    assert(tree->nodes);
+
+    for (size_t i = old_capacity; i < tree->capacity; i++) {
+      tree->nodes[i].parent = i + 1 < tree->capacity ? i + 1 : TREE_NULL_NODE;
+    }
+    tree->free_list = old_capacity;
+  }
+
+  size_t index = tree->free_list;
+  tree_node_t *node = &tree->nodes[index];
+  tree->free_list = node->parent;
+  node->parent = TREE_NULL_NODE;
+  node->child1 = TREE_NULL_NODE;
+  node->child2 = TREE_NULL_NODE;
+  node->height = 0;
+  return index;
+}
+
+static void tree_free_node(aabb_tree_t *tree, size_t index) {
+  tree->nodes[index].parent = tree->free_list;
+  tree->free_list = index;
+}
+
+/**
+ * Points the parent of a node that was replaced at its replacement.
+ */
+static void tree_replace_child(aabb_tree_t *tree, size_t parent,
+                               size_t old_child, size_t new_child) {
+  if (parent == TREE_NULL_NODE) {
+    tree->root = new_child;
+  } else if (tree->nodes[parent].child1 == old_child) {
+    tree->nodes[parent].child1 = new_child;
+  } else {
+    tree->nodes[parent].child2 = new_child;
+  }
+}
+
+/**
+ * Rotates the taller child of a node up if its children's heights differ by
+ * more than one, like in an AVL tree.
+ *
+ * @return the index of the node now at the rotated node's place
+ */
+static size_t tree_balance(aabb_tree_t *tree, size_t a_index) {
+  tree_node_t *a = &tree->nodes[a_index];
+  if (node_is_leaf(a) || a->height < 2) {
+    return a_index;
+  }
+
+  size_t b_index = a->child1;
+  size_t c_index = a->child2;
+  tree_node_t *b = &tree->nodes[b_index];
+  tree_node_t *c = &tree->nodes[c_index];
+
+  if (c->height > b->height + 1) {
+    size_t f_index = c->child1;
+    size_t g_index = c->child2;
+    tree_node_t *f = &tree->nodes[f_index];
+    tree_node_t *g = &tree->nodes[g_index];
+
+    // c takes a's place, and a takes c's shorter child
+    c->child1 = a_index;
+    c->parent = a->parent;
+    a->parent = c_index;
+    tree_replace_child(tree, c->parent, a_index, c_index);
+
+    if (f->height > g->height) {
+      c->child2 = f_index;
+      a->child2 = g_index;
+      g->parent = a_index;
+      a->bounds = aabb_union(b->bounds, g->bounds);
+      c->bounds = aabb_union(a->bounds, f->bounds);
+      a->height = 1 + max_height(b->height, g->height);
+      c->height = 1 + max_height(a->height, f->height);
+    } else {
+      c->child2 = g_index;
+      a->child2 = f_index;
+      f->parent = a_index;
+      a->bounds = aabb_union(b->bounds, f->bounds);
+      c->bounds = aabb_union(a->bounds, g->bounds);
+      a->height = 1 + max_height(b->height, f->height);
+      c->height = 1 + max_height(a->height, g->height);
+    }
+    return c_index;
+  }
+
+  if (b->height > c->height + 1) {
+    size_t d_index = b->child1;
+    size_t e_index = b->child2;
+    tree_node_t *d = &tree->nodes[d_index];
+    tree_node_t *e = &tree->nodes[e_index];
+
+    // b takes a's place, and a takes b's shorter child
+    b->child1 = a_index;
+    b->parent = a->parent;
+    a->parent = b_index;
+    tree_replace_child(tree, b->parent, a_index, b_index);
+
+    if (d->height > e->height) {
+      b->child2 = d_index;
+      a->child1 = e_index;
+      e->parent = a_index;
+      a->bounds = aabb_union(c->bounds, e->bounds);
+      b->bounds = aabb_union(a->bounds, d->bounds);
+      a->height = 1 + max_height(c->height, e->height);
+      b->height = 1 + max_height(a->height, d->height);
+    } else {
+      b->child2 = e_index;
+      a->child1 = d_index;
+      d->parent = a_index;
+      a->bounds = aabb_union(c->bounds, d->bounds);
+      b->bounds = aabb_union(a->bounds, e->bounds);
+      a->height = 1 + max_height(c->height, d->height);
+      b->height = 1 + max_height(a->height, e->height);
+    }
+    return b_index;
+  }
+
+  return a_index;
+}
+
+/**
+ * Rebalances and refits the boxes and heights of a node and its ancestors.
+ */
+static void tree_refit(aabb_tree_t *tree, size_t index) {
+  while (index != TREE_NULL_NODE) {
+    index = tree_balance(tree, index);
+
+    tree_node_t *node = &tree->nodes[index];
+    tree_node_t *child1 = &tree->nodes[node->child1];
+    tree_node_t *child2 = &tree->nodes[node->child2];
+    node->height = 1 + max_height(child1->height, child2->height);
+    node->bounds = aabb_union(child1->bounds, child2->bounds);
+
+    index = node->parent;
+  }
+}
+
+/**
+ * Finds the node a new box is cheapest to pair with, descending while a
+ * child's cost (including the growth it forces on its ancestors) is lower
+ * than pairing with the node itself.
+ */
+static size_t tree_find_sibling(aabb_tree_t *tree, aabb_t bounds) {
+  size_t index = tree->root;
+  while (!node_is_leaf(&tree->nodes[index])) {
+    tree_node_t *node = &tree->nodes[index];
+    double area = aabb_perimeter(node->bounds);
+    double combined = aabb_perimeter(aabb_union(node->bounds, bounds));
+    double cost = 2 * combined;
+    double inheritance = 2 * (combined - area);
+
+    double child_costs[2];
+    size_t children[2] = {node->child1, node->child2};
+    for (size_t i = 0; i < 2; i++) {
+      tree_node_t *child = &tree->nodes[children[i]];
+      double child_combined =
+          aabb_perimeter(aabb_union(child->bounds, bounds));
+      if (node_is_leaf(child)) {
+        child_costs[i] = child_combined + inheritance;
+      } else {
+        child_costs[i] =
+            child_combined - aabb_perimeter(child->bounds) + inheritance;
+      }
+    }
+
+    if (cost < child_costs[0] && cost < child_costs[1]) {
+      break;
+    }
+    index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+  }
+  return index;
+}
+
+size_t aabb_tree_insert(aabb_tree_t *tree, aabb_t bounds, size_t value) {
+  // an infinite perimeter makes every cost in tree_find_sibling() NaN
+  assert(isfinite(aabb_perimeter(bounds)));
+  size_t leaf = tree_alloc_node(tree);
+  tree->nodes[leaf].bounds = bounds;
+  tree->nodes[leaf].value = value;
+
+  if (tree->root == TREE_NULL_NODE) {
+    tree->root = leaf;
+    return leaf;
+  }
+
+  size_t sibling = tree_find_sibling(tree, bounds);
+  size_t new_parent = tree_alloc_node(tree);
+  size_t old_parent = tree->nodes[sibling].parent;
+
+  tree_node_t *parent = &tree->nodes[new_parent];
+  parent->parent = old_parent;
+  parent->child1 = sibling;
+  parent->child2 = leaf;
+  parent->bounds = aabb_union(tree->nodes[sibling].bounds, bounds);
+  parent->height = tree->nodes[sibling].height + 1;
+  tree_replace_child(tree, old_parent, sibling, new_parent);
+  tree->nodes[sibling].parent = new_parent;
+  tree->nodes[leaf].parent = new_parent;
+
+  tree_refit(tree, new_parent);
+  return leaf;
+}
+
+void aabb_tree_remove(aabb_tree_t *tree, size_t leaf) {
+  assert(leaf < tree->capacity && node_is_leaf(&tree->nodes[leaf]));
+
+  if (leaf == tree->root) {
+    tree->root = TREE_NULL_NODE;
+    tree_free_node(tree, leaf);
+    return;
+  }
+
+  // the leaf's sibling takes its parent's place
+  size_t parent = tree->nodes[leaf].parent;
+  size_t grandparent = tree->nodes[parent].parent;
+  size_t sibling = tree->nodes[parent].child1 == leaf
+                       ? tree->nodes[parent].child2
+                       : tree->nodes[parent].child1;
+
+  tree_replace_child(tree, grandparent, parent, sibling);
+  tree->nodes[sibling].parent = grandparent;
+  tree_free_node(tree, parent);
+  tree_free_node(tree, leaf);
+
+  tree_refit(tree, grandparent);
+}
+
+aabb_t aabb_tree_get_bounds(aabb_tree_t *tree, size_t leaf) {
+  assert(leaf < tree->capacity);
+  return tree->nodes[leaf].bounds;
+}
+
+void aabb_tree_set_value(aabb_tree_t *tree, size_t leaf, size_t value) {
+  assert(leaf < tree->capacity);
+  tree->nodes[leaf].value = value;
+}
+
+/**
+ * Visits every leaf whose box passes a test, descending only into nodes
+ * whose boxes pass it too. The test is either an overlapping box or, if
+ * bounds is NULL, a segment crossing the box.
+ */
+static void query_tree(aabb_tree_t *tree, aabb_t *bounds, vector_t start,
+                       vector_t end, aabb_tree_query_func_t func, void *aux) {
+  if (tree->root == TREE_NULL_NODE) {
+    return;
+  }
+
+  // a balanced tree is shallow, so the stack rarely grows
+  size_t num_stack = 0;
+  if (tree->stack_capacity == 0) {
+    tree->stack_capacity = TREE_INITIAL_CAPACITY;
+    tree->stack = malloc(sizeof(size_t) * tree->stack_capacity);
+    assert(tree->stack);
+  }
+  tree->stack[num_stack++] = tree->root;
+
+  while (num_stack > 0) {
+    tree_node_t *node = &tree->nodes[tree->stack[--num_stack]];
+    bool crossed = bounds != NULL
+                       ? aabb_overlap(node->bounds, *bounds)
+                       : aabb_segment_overlap(node->bounds, start, end);
+    if (!crossed) {
+      continue;
+    }
+    if (node_is_leaf(node)) {
+      func(node->value, aux);
+      continue;
+    }
+
+    if (num_stack + 2 > tree->stack_capacity) {
+      tree->stack_capacity *= 2;
+      tree->stack = realloc(tree->stack, sizeof(size_t) * tree->stack_capacity);
+      assert(tree->stack);
+    }
+    tree->stack[num_stack++] = node->child1;
+    tree->stack[num_stack++] = node->child2;
+  }
+}
+
+void aabb_tree_query(aabb_tree_t *tree, aabb_t bounds,
+                     aabb_tree_query_func_t func, void *aux) {
+  query_tree(tree, &bounds, VEC_ZERO, VEC_ZERO, func, aux);
+}
+
+void aabb_tree_query_segment(aabb_tree_t *tree, vector_t start, vector_t end,
+                             aabb_tree_query_func_t func, void *aux) {
+  query_tree(tree, NULL, start, end, func, aux);
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -7,14 +8,26 @@
 
 struct body {
   polygon_t *poly;
+  // the simpler shape the body collides as, or NULL to collide as poly
+  polygon_t *proxy;
 
   double mass;
+  // the mass properties don't change as the body moves, so are found once
+  double area;
+  double inertia;
   vector_t centroid;
+  aabb_t aabb;
 
   vector_t force;
   vector_t impulse;
   bool removed;
 
+  bool bullet;
+  vector_t motion;
+
+  size_t layer;
+  uint32_t mask;
+
   void *info;
   free_func_t info_freer;
 };
@@ -26,12 +39,144 @@ struct enemy_body {
 
 const double INITIAL_ROT = 0;
 const vector_t INIT_VEL = {0, 0};
+const size_t CIRCLE_SHAPE_POINTS = 100;
+const size_t NUM_COLLISION_LAYERS = 32;
+const double DEFAULT_COLLISION_ERROR = 0.01;
+
+/**
+ * Recomputes a body's bounding box from the vertices of its collision shape.
+ *
+ * @param body the body whose bounding box to update
+ */
+static void body_update_aabb(body_t *body) {
+  polygon_t *poly = body_get_collision_polygon(body);
+  if (polygon_get_type(poly) == SHAPE_HALF_PLANE) {
+    vector_t point = polygon_get_center(poly);
+    vector_t normal = polygon_get_normals(poly)[0];
+    aabb_t aabb = {{-__DBL_MAX__, -__DBL_MAX__}, {__DBL_MAX__, __DBL_MAX__}};
+    // only a horizontal or vertical boundary bounds the box on one side
+    if (normal.y == 0 && normal.x > 0) {
+      aabb.max.x = point.x;
+    } else if (normal.y == 0) {
+      aabb.min.x = point.x;
+    } else if (normal.x == 0 && normal.y > 0) {
+      aabb.max.y = point.y;
+    } else if (normal.x == 0) {
+      aabb.min.y = point.y;
+    }
+    body->aabb = aabb;
+    return;
+  }
+
+  if (polygon_get_type(poly) == SHAPE_CIRCLE) {
+    vector_t center = polygon_get_center(poly);
+    double radius = polygon_get_radius(poly);
+    body->aabb.min = vec_subtract(center, (vector_t){radius, radius});
+    body->aabb.max = vec_add(center, (vector_t){radius, radius});
+    return;
+  }
+
+  const vector_t *vertices = polygon_get_vertices(poly);
+  aabb_t aabb = {{__DBL_MAX__, __DBL_MAX__}, {-__DBL_MAX__, -__DBL_MAX__}};
+
+  for (size_t i = 0; i < polygon_get_num_vertices(poly); i++) {
+    aabb.min.x = fmin(aabb.min.x, vertices[i].x);
+    aabb.min.y = fmin(aabb.min.y, vertices[i].y);
+    aabb.max.x = fmax(aabb.max.x, vertices[i].x);
+    aabb.max.y = fmax(aabb.max.y, vertices[i].y);
+  }
+
+  body->aabb = aabb;
+}
+
+/**
+ * Moves a body's collision proxy along with a translation of its polygon.
+ * A circular proxy is put back on the body's centroid instead, so the two
+ * can't drift apart by rounding.
+ */
+static void body_move_proxy(body_t *body, vector_t translation) {
+  if (body->proxy == NULL) {
+    return;
+  }
+  if (polygon_get_type(body->proxy) == SHAPE_CIRCLE) {
+    polygon_set_center(body->proxy, body->centroid);
+  } else {
+    polygon_translate(body->proxy, translation);
+  }
+}
+
+/**
+ * Gets how thick a polygon is: how far its centroid is from its nearest edge.
+ */
+static double polygon_thickness(polygon_t *poly) {
+  if (polygon_get_type(poly) == SHAPE_CIRCLE) {
+    return polygon_get_radius(poly);
+  }
+
+  vector_t center = polygon_centroid(poly);
+  const vector_t *vertices = polygon_get_vertices(poly);
+  size_t size = polygon_get_num_vertices(poly);
+  double thickness = __DBL_MAX__;
+  for (size_t i = 0; i < size; i++) {
+    vector_t curr = vertices[i];
+    vector_t edge = vec_subtract(vertices[(i + 1) % size], curr);
+    double length = vec_get_length(edge);
+    if (length > 0) {
+      double distance =
+          fabs(vec_cross(edge, vec_subtract(center, curr))) / length;
+      thickness = fmin(thickness, distance);
+    }
+  }
+  return thickness;
+}
 
 void body_reset(body_t *body) {
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
 }
 
+/**
+ * Allocates memory for a body around an already initialized polygon,
+ * without a collision proxy or bounding box yet.
+ */
+static body_t *body_alloc(polygon_t *poly, double mass, void *info,
+                          free_func_t info_freer) {
+  body_t *ret = malloc(sizeof(body_t));
+  assert(ret);
+
+  ret->centroid = polygon_centroid(poly);
+  ret->force = VEC_ZERO;
+  ret->impulse = VEC_ZERO;
+  ret->info = info;
+  ret->info_freer = info_freer;
+  ret->mass = mass;
+  ret->area = polygon_area(poly);
+  ret->inertia = mass >= __DBL_MAX__ ? INFINITY
+                                     : polygon_moment_of_inertia(poly, mass);
+  ret->poly = poly;
+  ret->proxy = NULL;
+  ret->removed = false;
+  ret->bullet = false;
+  ret->motion = VEC_ZERO;
+  ret->layer = 0;
+  ret->mask = UINT32_MAX;
+
+  return ret;
+}
+
+/**
+ * Allocates memory for a body around an already initialized polygon,
+ * which collides as a proxy within the default tolerance of it.
+ */
+static body_t *body_init_with_polygon(polygon_t *poly, double mass, void *info,
+                                      free_func_t info_freer) {
+  body_t *ret = body_alloc(poly, mass, info, info_freer);
+  double tolerance = DEFAULT_COLLISION_ERROR * polygon_thickness(poly);
+  body_set_collision_tolerance(ret, tolerance);
+
+  return ret;
+}
+
 /**
  * Allocates memory for a body with the given parameters.
  * The body is initially at rest.
@@ -47,20 +192,60 @@ void body_reset(body_t *body) {
  */
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer) {
-  body_t *ret = malloc(sizeof(body_t));
-  assert(ret);
-
   polygon_t *poly =
       polygon_init(shape, INIT_VEL, INITIAL_ROT, color.r, color.g, color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
 
-  ret->centroid = polygon_centroid(poly);
-  ret->force = VEC_ZERO;
-  ret->impulse = VEC_ZERO;
-  ret->info = info;
-  ret->info_freer = info_freer;
-  ret->mass = mass;
-  ret->poly = poly;
-  ret->removed = false;
+body_t *body_init_circle_with_info(vector_t center, double radius, double mass,
+                                   rgb_color_t color, void *info,
+                                   free_func_t info_freer) {
+  polygon_t *poly = polygon_init_circle(center, radius, INIT_VEL, INITIAL_ROT,
+                                        color.r, color.g, color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
+
+body_t *body_init_segment_with_info(vector_t start, vector_t end, double mass,
+                                    rgb_color_t color, void *info,
+                                    free_func_t info_freer) {
+  list_t *shape = list_init(2, free);
+  vector_t ends[] = {start, end};
+  for (size_t i = 0; i < 2; i++) {
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point);
+    *point = ends[i];
+    list_add(shape, point);
+  }
+  return body_init_with_info(shape, mass, color, info, info_freer);
+}
+
+body_t *body_init_half_plane_with_info(vector_t point, vector_t normal,
+                                       double mass, rgb_color_t color,
+                                       void *info, free_func_t info_freer) {
+  polygon_t *poly = polygon_init_half_plane(point, normal, INIT_VEL,
+                                            INITIAL_ROT, color.r, color.g,
+                                            color.b);
+  return body_init_with_polygon(poly, mass, info, info_freer);
+}
+
+body_t *body_init_instance_with_info(body_t *prototype, vector_t centroid,
+                                     double mass, rgb_color_t color,
+                                     void *info, free_func_t info_freer) {
+  polygon_t *poly = polygon_init_instance(prototype->poly, centroid, INIT_VEL,
+                                          INITIAL_ROT, color.r, color.g,
+                                          color.b);
+  body_t *ret = body_alloc(poly, mass, info, info_freer);
+
+  // the proxy sits where it did on the prototype before it was turned
+  if (prototype->proxy != NULL) {
+    vector_t offset = vec_rotate(
+        vec_subtract(polygon_get_center(prototype->proxy), prototype->centroid),
+        -body_get_rotation(prototype));
+    ret->proxy = polygon_init_instance(prototype->proxy,
+                                       vec_add(centroid, offset), INIT_VEL,
+                                       INITIAL_ROT, color.r, color.g, color.b);
+  }
+  body_update_aabb(ret);
 
   return ret;
 }
@@ -90,6 +275,21 @@ enemy_body_t *enemy_body_init_with_info(double health, list_t *shape,
   return ret;
 }
 
+enemy_body_t *enemy_body_init_circle_with_info(double health, vector_t center,
+                                               double radius, double mass,
+                                               rgb_color_t color, void *info,
+                                               free_func_t info_freer) {
+  enemy_body_t *ret = malloc(sizeof(enemy_body_t));
+  assert(ret);
+
+  body_t *body = body_init_circle_with_info(center, radius, mass, color, info,
+                                            info_freer);
+  ret->body = body;
+  ret->health = health;
+
+  return ret;
+}
+
 body_t *enemy_body_get_body(enemy_body_t *enemy) { return enemy->body; }
 
 double enemy_get_health(body_t *enemy) {
@@ -102,6 +302,19 @@ void enemy_subtract_health(body_t *enemy, double minus) {
 
 polygon_t *body_get_polygon(body_t *body) { return body->poly; }
 
+polygon_t *body_get_collision_polygon(body_t *body) {
+  return body->proxy != NULL ? body->proxy : body->poly;
+}
+
+void body_set_collision_tolerance(body_t *body, double tolerance) {
+  if (body->proxy != NULL) {
+    polygon_free(body->proxy);
+  }
+  body->proxy = polygon_simplify(body->poly, tolerance);
+  body_move_proxy(body, VEC_ZERO);
+  body_update_aabb(body);
+}
+
 void *body_get_info(body_t *body) { return body->info; }
 
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
@@ -110,6 +323,9 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
 
 void body_free(body_t *body) {
   polygon_free(body->poly);
+  if (body->proxy != NULL) {
+    polygon_free(body->proxy);
+  }
 
   if (body->info_freer != NULL) {
     body->info_freer(body->info);
@@ -124,17 +340,32 @@ void enemy_body_free(enemy_body_t *enemy) {
 }
 
 list_t *body_get_shape(body_t *body) {
-  list_t *ret =
-      list_init(list_size(polygon_get_points(body->poly)), (free_func_t)free);
+  if (polygon_get_type(body->poly) == SHAPE_CIRCLE) {
+    vector_t center = polygon_get_center(body->poly);
+    double radius = polygon_get_radius(body->poly);
+    list_t *ret = list_init(CIRCLE_SHAPE_POINTS, (free_func_t)free);
+
+    for (size_t i = 0; i < CIRCLE_SHAPE_POINTS; i++) {
+      double angle = 2 * M_PI * i / CIRCLE_SHAPE_POINTS;
+      vector_t *curr = malloc(sizeof(vector_t));
+      assert(curr);
+
+      *curr = (vector_t){center.x + radius * cos(angle),
+                         center.y + radius * sin(angle)};
+      list_add(ret, curr);
+    }
+    return ret;
+  }
+
+  const vector_t *vertices = polygon_get_vertices(body->poly);
+  size_t size = polygon_get_num_vertices(body->poly);
+  list_t *ret = list_init(size, (free_func_t)free);
 
-  for (size_t i = 0; i < list_size(polygon_get_points(body->poly)); i++) {
+  for (size_t i = 0; i < size; i++) {
     vector_t *curr = malloc(sizeof(vector_t));
     assert(curr);
 
-    vector_t *old_vector = list_get(polygon_get_points(body->poly), i);
-
-    curr->x = old_vector->x;
-    curr->y = old_vector->y;
+    *curr = vertices[i];
 
     list_add(ret, curr);
   }
@@ -142,8 +373,35 @@ list_t *body_get_shape(body_t *body) {
   return ret;
 }
 
+vertex_span_t body_get_vertices(body_t *body) {
+  return (vertex_span_t){polygon_get_vertices(body->poly),
+                         polygon_get_num_vertices(body->poly)};
+}
+
+shape_type_t body_get_shape_type(body_t *body) {
+  return polygon_get_type(body_get_collision_polygon(body));
+}
+
+double body_get_radius(body_t *body) {
+  return polygon_get_radius(body_get_collision_polygon(body));
+}
+
 vector_t body_get_centroid(body_t *body) { return body->centroid; }
 
+aabb_t body_get_aabb(body_t *body) {
+  if (!body->bullet) {
+    return body->aabb;
+  }
+
+  // the box at the start of the tick, joined with the box at the end
+  aabb_t start = {vec_subtract(body->aabb.min, body->motion),
+                  vec_subtract(body->aabb.max, body->motion)};
+  return (aabb_t){{fmin(start.min.x, body->aabb.min.x),
+                   fmin(start.min.y, body->aabb.min.y)},
+                  {fmax(start.max.x, body->aabb.max.x),
+                   fmax(start.max.y, body->aabb.max.y)}};
+}
+
 vector_t body_get_velocity(body_t *body) {
   double x_vel = polygon_get_velocity_x(body->poly);
   double y_vel = polygon_get_velocity_y(body->poly);
@@ -160,9 +418,13 @@ void body_set_color(body_t *body, rgb_color_t *col) {
 }
 
 void body_set_centroid(body_t *body, vector_t v) {
+  vector_t shift = vec_subtract(v, polygon_centroid(body->poly));
   polygon_set_center(body->poly, v);
 
   body->centroid = v;
+  body_move_proxy(body, shift);
+  body->motion = VEC_ZERO;
+  body_update_aabb(body);
 }
 
 void body_set_velocity(body_t *body, vector_t v) {
@@ -174,7 +436,13 @@ double body_get_rotation(body_t *body) {
 }
 
 void body_set_rotation(body_t *body, double angle) {
+  double turn = angle - polygon_get_rotation(body->poly);
   polygon_set_rotation(body->poly, angle);
+  // a circular proxy is centered on the centroid, so turning doesn't move it
+  if (body->proxy != NULL && polygon_get_type(body->proxy) == SHAPE_POLYGON) {
+    polygon_rotate(body->proxy, turn, polygon_get_center(body->poly));
+  }
+  body_update_aabb(body);
 }
 
 void body_tick(body_t *body, double dt) {
@@ -190,13 +458,57 @@ void body_tick(body_t *body, double dt) {
 
   polygon_set_velocity(body->poly, v_new);
   polygon_translate(body->poly, change);
-  body->centroid = polygon_centroid(body->poly);
+  // a translation moves every vertex, and so the bounds, by the same amount
+  body->aabb.min = vec_add(body->aabb.min, change);
+  body->aabb.max = vec_add(body->aabb.max, change);
+  body->centroid = polygon_get_center(body->poly);
+  body_move_proxy(body, change);
+  body->motion = change;
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
 }
 
 double body_get_mass(body_t *body) { return body->mass; }
 
+double body_get_area(body_t *body) { return body->area; }
+
+double body_get_moment_of_inertia(body_t *body) { return body->inertia; }
+
+bool body_is_static(body_t *body) { return body->mass >= __DBL_MAX__; }
+
+void body_set_bullet(body_t *body, bool bullet) { body->bullet = bullet; }
+
+bool body_is_bullet(body_t *body) { return body->bullet; }
+
+void body_set_layer(body_t *body, size_t layer) {
+  assert(layer < NUM_COLLISION_LAYERS);
+  body->layer = layer;
+}
+
+size_t body_get_layer(body_t *body) { return body->layer; }
+
+void body_set_mask(body_t *body, uint32_t mask) { body->mask = mask; }
+
+uint32_t body_get_mask(body_t *body) { return body->mask; }
+
+bool body_layers_collide(body_t *body1, body_t *body2) {
+  return (body1->mask >> body2->layer & 1) && (body2->mask >> body1->layer & 1);
+}
+
+vector_t body_get_motion(body_t *body) { return body->motion; }
+
+void body_rewind(body_t *body, double time) {
+  assert(time >= 0 && time <= 1);
+
+  vector_t back = vec_multiply(time - 1, body->motion);
+  polygon_translate(body->poly, back);
+  body->aabb.min = vec_add(body->aabb.min, back);
+  body->aabb.max = vec_add(body->aabb.max, back);
+  body->centroid = vec_add(body->centroid, back);
+  body_move_proxy(body, back);
+  body->motion = vec_multiply(time, body->motion);
+}
+
 void body_add_force(body_t *body, vector_t force) {
   body->force = vec_add(body->force, force);
 }
@@ -205,6 +517,12 @@ void body_add_impulse(body_t *body, vector_t impulse) {
   body->impulse = vec_add(body->impulse, impulse);
 }
 
+vector_t body_get_next_velocity(body_t *body, double dt) {
+  vector_t change = vec_add(vec_multiply(dt, body->force), body->impulse);
+  return vec_add(body_get_velocity(body),
+                 vec_multiply(1 / body->mass, change));
+}
+
 void body_remove(body_t *body) { body->removed = true; }
 
 bool body_is_removed(body_t *body) { return body->removed; }
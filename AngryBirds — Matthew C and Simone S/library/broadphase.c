@@ -0,0 +1,820 @@
+#include "broadphase.h"
+#include "aabb_tree.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t MAX_CELLS_PER_BODY = 64;
+const size_t MIN_BUCKETS = 64;
+const double MAX_CELL_COORD = 1e9;
+const size_t HASH_PRIME_X = 73856093;
+const size_t HASH_PRIME_Y = 19349663;
+const size_t NOT_ACTIVE = (size_t)-1;
+const double TREE_FAT_MARGIN = 10;
+
+/**
+ * A body's entry in the broadphase, holding its bounds and the range of
+ * cells they cover.
+ * Bodies covering too many cells (e.g. the walls of the world) are
+ * "oversized": they are kept out of the grid and checked against every body.
+ * A tree broadphase does the same with unbounded bodies, i.e. half-planes.
+ */
+typedef struct proxy {
+  body_t *body;
+  aabb_t bounds;
+  long min_x;
+  long min_y;
+  long max_x;
+  long max_y;
+  bool oversized;
+  size_t active;
+  size_t leaf;
+  bool is_static;
+} proxy_t;
+
+typedef struct cell_entry {
+  long x;
+  long y;
+  size_t proxy;
+} cell_entry_t;
+
+/**
+ * One end of a proxy's bounds on the x axis, for sweep and prune.
+ */
+typedef struct endpoint {
+  double value;
+  size_t proxy;
+  bool is_max;
+} endpoint_t;
+
+typedef struct index_pair {
+  size_t first;
+  size_t second;
+} index_pair_t;
+
+struct broadphase {
+  broadphase_type_t type;
+  double cell_size;
+
+  proxy_t *proxies;
+  size_t num_proxies;
+  size_t proxy_capacity;
+
+  size_t *oversized;
+  size_t num_oversized;
+
+  cell_entry_t *entries;
+  cell_entry_t *sorted_entries;
+  size_t num_entries;
+  size_t entry_capacity;
+
+  size_t *bucket_starts;
+  size_t num_buckets;
+
+  endpoint_t *endpoints;
+  size_t num_endpoints;
+  size_t endpoint_capacity;
+  size_t *active;
+  size_t *remap;
+
+  aabb_tree_t *static_tree;
+  aabb_tree_t *moving_tree;
+  size_t query_proxy;
+
+  index_pair_t *pairs;
+  size_t num_pairs;
+  size_t pair_capacity;
+
+  size_t *query_results;
+  size_t num_query_results;
+  size_t query_capacity;
+};
+
+/**
+ * Grows an array so it can hold at least the given number of elements.
+ *
+ * @param array the array to grow (may be NULL)
+ * @param capacity the current capacity of the array, updated if it grows
+ * @param needed the number of elements the array must hold
+ * @param elem_size the size of one element
+ * @return the (possibly moved) array
+ */
+static void *grow_array(void *array, size_t *capacity, size_t needed,
+                        size_t elem_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  size_t new_capacity = *capacity == 0 ? 1 : *capacity;
+  while (new_capacity < needed) {
+    new_capacity *= 2;
+  }
+  array = realloc(array, new_capacity * elem_size);
+  assert(array);
+  *capacity = new_capacity;
+  return array;
+}
+
+static broadphase_t *broadphase_init_with_type(broadphase_type_t type,
+                                               double cell_size) {
+  broadphase_t *broadphase = malloc(sizeof(broadphase_t));
+  assert(broadphase);
+
+  broadphase->type = type;
+  broadphase->cell_size = cell_size;
+  broadphase->proxies = NULL;
+  broadphase->num_proxies = 0;
+  broadphase->proxy_capacity = 0;
+  broadphase->oversized = NULL;
+  broadphase->num_oversized = 0;
+  broadphase->entries = NULL;
+  broadphase->sorted_entries = NULL;
+  broadphase->num_entries = 0;
+  broadphase->entry_capacity = 0;
+  broadphase->bucket_starts = NULL;
+  broadphase->num_buckets = 0;
+  broadphase->endpoints = NULL;
+  broadphase->num_endpoints = 0;
+  broadphase->endpoint_capacity = 0;
+  broadphase->active = NULL;
+  broadphase->remap = NULL;
+  broadphase->static_tree = NULL;
+  broadphase->moving_tree = NULL;
+  broadphase->pairs = NULL;
+  broadphase->num_pairs = 0;
+  broadphase->pair_capacity = 0;
+  broadphase->query_results = NULL;
+  broadphase->num_query_results = 0;
+  broadphase->query_capacity = 0;
+
+  return broadphase;
+}
+
+broadphase_t *broadphase_init(double cell_size) {
+  assert(cell_size > 0);
+  return broadphase_init_with_type(BROADPHASE_GRID, cell_size);
+}
+
+broadphase_t *broadphase_init_sweep_and_prune(void) {
+  return broadphase_init_with_type(BROADPHASE_SWEEP_AND_PRUNE, 0);
+}
+
+broadphase_t *broadphase_init_tree(void) {
+  broadphase_t *broadphase = broadphase_init_with_type(BROADPHASE_TREE, 0);
+  broadphase->static_tree = aabb_tree_init();
+  broadphase->moving_tree = aabb_tree_init();
+  return broadphase;
+}
+
+void broadphase_free(broadphase_t *broadphase) {
+  free(broadphase->proxies);
+  free(broadphase->oversized);
+  free(broadphase->entries);
+  free(broadphase->sorted_entries);
+  free(broadphase->bucket_starts);
+  free(broadphase->endpoints);
+  free(broadphase->active);
+  free(broadphase->remap);
+  if (broadphase->type == BROADPHASE_TREE) {
+    aabb_tree_free(broadphase->static_tree);
+    aabb_tree_free(broadphase->moving_tree);
+  }
+  free(broadphase->pairs);
+  free(broadphase->query_results);
+  free(broadphase);
+}
+
+/**
+ * Finds the range of grid cells a box covers.
+ *
+ * @param range set to the lowest and highest cell on each axis, in the order
+ *   min x, min y, max x, max y, if the box fits
+ * @return whether the box covers few enough cells to be put in the grid
+ */
+static bool cell_range(broadphase_t *broadphase, aabb_t bounds,
+                       long range[4]) {
+  double min_x = floor(bounds.min.x / broadphase->cell_size);
+  double min_y = floor(bounds.min.y / broadphase->cell_size);
+  double max_x = floor(bounds.max.x / broadphase->cell_size);
+  double max_y = floor(bounds.max.y / broadphase->cell_size);
+  double cells = (max_x - min_x + 1) * (max_y - min_y + 1);
+
+  // also catches NaN and infinite coordinates, which never fit in the grid
+  if (!(cells <= MAX_CELLS_PER_BODY) || !(fabs(min_x) < MAX_CELL_COORD) ||
+      !(fabs(min_y) < MAX_CELL_COORD) || !(fabs(max_x) < MAX_CELL_COORD) ||
+      !(fabs(max_y) < MAX_CELL_COORD)) {
+    return false;
+  }
+
+  range[0] = (long)min_x;
+  range[1] = (long)min_y;
+  range[2] = (long)max_x;
+  range[3] = (long)max_y;
+  return true;
+}
+
+/**
+ * Determines whether a box has a finite perimeter. The bounds of a
+ * half-plane reach out to +/-__DBL_MAX__, so their size overflows.
+ */
+static bool aabb_is_bounded(aabb_t bounds) {
+  return isfinite((bounds.max.x - bounds.min.x) +
+                  (bounds.max.y - bounds.min.y));
+}
+
+/**
+ * Fills in the bounds and cell range of a proxy from its body.
+ */
+static void proxy_compute(broadphase_t *broadphase, proxy_t *proxy) {
+  proxy->bounds = body_get_aabb(proxy->body);
+  proxy->active = NOT_ACTIVE;
+  proxy->oversized = false;
+  if (broadphase->type == BROADPHASE_TREE) {
+    // a tree ranks where to put a box by its perimeter
+    proxy->oversized = !aabb_is_bounded(proxy->bounds);
+    return;
+  }
+  if (broadphase->type != BROADPHASE_GRID) {
+    return;
+  }
+
+  long range[4];
+  proxy->oversized = !cell_range(broadphase, proxy->bounds, range);
+  if (proxy->oversized) {
+    return;
+  }
+
+  proxy->min_x = range[0];
+  proxy->min_y = range[1];
+  proxy->max_x = range[2];
+  proxy->max_y = range[3];
+}
+
+static size_t cell_hash(long x, long y) {
+  return ((size_t)x * HASH_PRIME_X) ^ ((size_t)y * HASH_PRIME_Y);
+}
+
+static void add_pair(broadphase_t *broadphase, size_t i, size_t j) {
+  broadphase->pairs =
+      grow_array(broadphase->pairs, &broadphase->pair_capacity,
+                 broadphase->num_pairs + 1, sizeof(index_pair_t));
+  index_pair_t pair = {i < j ? i : j, i < j ? j : i};
+  broadphase->pairs[broadphase->num_pairs++] = pair;
+}
+
+static int compare_pairs(const void *p1, const void *p2) {
+  const index_pair_t *pair1 = p1;
+  const index_pair_t *pair2 = p2;
+  if (pair1->first != pair2->first) {
+    return pair1->first < pair2->first ? -1 : 1;
+  }
+  if (pair1->second != pair2->second) {
+    return pair1->second < pair2->second ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Inserts every grid proxy into each cell its bounds cover, then groups the
+ * cell entries by hash bucket with a counting sort.
+ */
+static void fill_grid(broadphase_t *broadphase) {
+  size_t old_capacity = broadphase->entry_capacity;
+  broadphase->num_entries = 0;
+  for (size_t i = 0; i < broadphase->num_proxies; i++) {
+    proxy_t *proxy = &broadphase->proxies[i];
+    if (proxy->oversized) {
+      continue;
+    }
+    size_t cells =
+        (proxy->max_x - proxy->min_x + 1) * (proxy->max_y - proxy->min_y + 1);
+    broadphase->entries =
+        grow_array(broadphase->entries, &broadphase->entry_capacity,
+                   broadphase->num_entries + cells, sizeof(cell_entry_t));
+    for (long x = proxy->min_x; x <= proxy->max_x; x++) {
+      for (long y = proxy->min_y; y <= proxy->max_y; y++) {
+        cell_entry_t entry = {x, y, i};
+        broadphase->entries[broadphase->num_entries++] = entry;
+      }
+    }
+  }
+
+  size_t num_buckets = MIN_BUCKETS;
+  while (num_buckets < 2 * broadphase->num_entries) {
+    num_buckets *= 2;
+  }
+  // the table only ever grows, so a steady scene never reallocates it
+  if (num_buckets > broadphase->num_buckets) {
+    free(broadphase->bucket_starts);
+    broadphase->bucket_starts = malloc(sizeof(size_t) * (num_buckets + 1));
+    assert(broadphase->bucket_starts);
+    broadphase->num_buckets = num_buckets;
+  }
+  num_buckets = broadphase->num_buckets;
+  if (broadphase->entry_capacity != old_capacity) {
+    free(broadphase->sorted_entries);
+    broadphase->sorted_entries =
+        malloc(sizeof(cell_entry_t) * broadphase->entry_capacity);
+    assert(broadphase->sorted_entries);
+  }
+
+  size_t *starts = broadphase->bucket_starts;
+  for (size_t b = 0; b <= num_buckets; b++) {
+    starts[b] = 0;
+  }
+  for (size_t e = 0; e < broadphase->num_entries; e++) {
+    cell_entry_t *entry = &broadphase->entries[e];
+    starts[(cell_hash(entry->x, entry->y) & (num_buckets - 1)) + 1]++;
+  }
+  for (size_t b = 0; b < num_buckets; b++) {
+    starts[b + 1] += starts[b];
+  }
+  for (size_t e = 0; e < broadphase->num_entries; e++) {
+    cell_entry_t *entry = &broadphase->entries[e];
+    size_t bucket = cell_hash(entry->x, entry->y) & (num_buckets - 1);
+    broadphase->sorted_entries[starts[bucket]++] = *entry;
+  }
+  // the fill loop advanced each start to the next bucket's start; shift back
+  for (size_t b = num_buckets; b > 0; b--) {
+    starts[b] = starts[b - 1];
+  }
+  starts[0] = 0;
+}
+
+/**
+ * Reports the overlapping pairs of bodies that share a grid cell.
+ * A pair of bodies can share several cells, so a pair is only reported from
+ * the cell holding the lower-left corner of the overlap of their cell ranges.
+ */
+static void find_grid_pairs(broadphase_t *broadphase) {
+  size_t *starts = broadphase->bucket_starts;
+  cell_entry_t *entries = broadphase->sorted_entries;
+
+  for (size_t b = 0; b < broadphase->num_buckets; b++) {
+    for (size_t e1 = starts[b]; e1 < starts[b + 1]; e1++) {
+      for (size_t e2 = e1 + 1; e2 < starts[b + 1]; e2++) {
+        // different cells can hash to the same bucket
+        if (entries[e1].x != entries[e2].x || entries[e1].y != entries[e2].y) {
+          continue;
+        }
+        proxy_t *proxy1 = &broadphase->proxies[entries[e1].proxy];
+        proxy_t *proxy2 = &broadphase->proxies[entries[e2].proxy];
+        long home_x = proxy1->min_x > proxy2->min_x ? proxy1->min_x
+                                                    : proxy2->min_x;
+        long home_y = proxy1->min_y > proxy2->min_y ? proxy1->min_y
+                                                    : proxy2->min_y;
+        if (entries[e1].x == home_x && entries[e1].y == home_y &&
+            aabb_overlap(proxy1->bounds, proxy2->bounds)) {
+          add_pair(broadphase, entries[e1].proxy, entries[e2].proxy);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Reports the pairs of an oversized body with every body it overlaps.
+ * Like the rest of a tree broadphase, two static bodies never pair up.
+ */
+static void find_oversized_pairs(broadphase_t *broadphase) {
+  bool skip_static = broadphase->type == BROADPHASE_TREE;
+  for (size_t o = 0; o < broadphase->num_oversized; o++) {
+    size_t i = broadphase->oversized[o];
+    proxy_t *big = &broadphase->proxies[i];
+
+    for (size_t j = 0; j < broadphase->num_proxies; j++) {
+      proxy_t *other = &broadphase->proxies[j];
+      // pairs of two oversized bodies are only reported once
+      if (j == i || (other->oversized && j < i)) {
+        continue;
+      }
+      if (skip_static && big->is_static && other->is_static) {
+        continue;
+      }
+      if (aabb_overlap(big->bounds, other->bounds)) {
+        add_pair(broadphase, i, j);
+      }
+    }
+  }
+}
+
+static aabb_tree_t *proxy_tree(broadphase_t *broadphase, proxy_t *proxy) {
+  return proxy->is_static ? broadphase->static_tree : broadphase->moving_tree;
+}
+
+/**
+ * Carries the state kept between updates over to a new list of bodies.
+ * The list is matched against the last update's in order, which finds every
+ * kept body when bodies are only removed or appended, as in a scene.
+ * Kept proxies move to their body's new index, and removed bodies leave the
+ * trees. Sorted endpoints keep their order, and the endpoints of new bodies
+ * are appended to be sorted in.
+ * Must run before the proxies are refreshed from the new list.
+ *
+ * @return the number of bodies kept, which are at the start of the list
+ */
+static size_t sync_proxies(broadphase_t *broadphase, list_t *bodies) {
+  size_t num_bodies = list_size(bodies);
+  size_t *remap = broadphase->remap;
+  size_t next = 0;
+  for (size_t j = 0; j < broadphase->num_proxies; j++) {
+    proxy_t *proxy = &broadphase->proxies[j];
+    if (next < num_bodies && list_get(bodies, next) == proxy->body) {
+      remap[j] = next++;
+    } else {
+      remap[j] = NOT_ACTIVE;
+      if (broadphase->type == BROADPHASE_TREE && !proxy->oversized) {
+        aabb_tree_remove(proxy_tree(broadphase, proxy), proxy->leaf);
+      }
+    }
+  }
+
+  // bodies only move towards the start of the list, so this is in place
+  for (size_t j = 0; j < broadphase->num_proxies; j++) {
+    if (remap[j] != NOT_ACTIVE) {
+      proxy_t *proxy = &broadphase->proxies[remap[j]];
+      *proxy = broadphase->proxies[j];
+      if (broadphase->type == BROADPHASE_TREE && !proxy->oversized) {
+        aabb_tree_set_value(proxy_tree(broadphase, proxy), proxy->leaf,
+                            remap[j]);
+      }
+    }
+  }
+
+  if (broadphase->type != BROADPHASE_SWEEP_AND_PRUNE) {
+    return next;
+  }
+
+  size_t kept = 0;
+  for (size_t e = 0; e < broadphase->num_endpoints; e++) {
+    endpoint_t endpoint = broadphase->endpoints[e];
+    if (remap[endpoint.proxy] != NOT_ACTIVE) {
+      endpoint.proxy = remap[endpoint.proxy];
+      broadphase->endpoints[kept++] = endpoint;
+    }
+  }
+  broadphase->num_endpoints = kept;
+
+  broadphase->endpoints = grow_array(
+      broadphase->endpoints, &broadphase->endpoint_capacity,
+      broadphase->num_endpoints + 2 * (num_bodies - next), sizeof(endpoint_t));
+  for (size_t i = next; i < num_bodies; i++) {
+    endpoint_t min = {0, i, false};
+    endpoint_t max = {0, i, true};
+    broadphase->endpoints[broadphase->num_endpoints++] = min;
+    broadphase->endpoints[broadphase->num_endpoints++] = max;
+  }
+  return next;
+}
+
+/**
+ * Orders endpoints along the x axis. Where a minimum and a maximum meet,
+ * the minimum comes first, so touching bounds count as overlapping.
+ */
+static bool endpoint_less(endpoint_t endpoint1, endpoint_t endpoint2) {
+  if (endpoint1.value != endpoint2.value) {
+    return endpoint1.value < endpoint2.value;
+  }
+  return !endpoint1.is_max && endpoint2.is_max;
+}
+
+/**
+ * Refreshes the endpoints from the proxies' bounds and re-sorts them with an
+ * insertion sort, which is nearly linear since they were sorted last tick.
+ */
+static void sort_endpoints(broadphase_t *broadphase) {
+  endpoint_t *endpoints = broadphase->endpoints;
+  for (size_t e = 0; e < broadphase->num_endpoints; e++) {
+    aabb_t bounds = broadphase->proxies[endpoints[e].proxy].bounds;
+    endpoints[e].value = endpoints[e].is_max ? bounds.max.x : bounds.min.x;
+  }
+
+  for (size_t e = 1; e < broadphase->num_endpoints; e++) {
+    endpoint_t endpoint = endpoints[e];
+    size_t j = e;
+    while (j > 0 && endpoint_less(endpoint, endpoints[j - 1])) {
+      endpoints[j] = endpoints[j - 1];
+      j--;
+    }
+    endpoints[j] = endpoint;
+  }
+}
+
+/**
+ * Sweeps the sorted endpoints, keeping the set of proxies whose x interval
+ * is open, and reports each proxy that opens against the open ones.
+ */
+static void find_sweep_pairs(broadphase_t *broadphase) {
+  size_t *active = broadphase->active;
+  size_t num_active = 0;
+
+  for (size_t e = 0; e < broadphase->num_endpoints; e++) {
+    endpoint_t endpoint = broadphase->endpoints[e];
+    proxy_t *proxy = &broadphase->proxies[endpoint.proxy];
+
+    if (!endpoint.is_max) {
+      for (size_t a = 0; a < num_active; a++) {
+        proxy_t *other = &broadphase->proxies[active[a]];
+        if (aabb_overlap(proxy->bounds, other->bounds)) {
+          add_pair(broadphase, endpoint.proxy, active[a]);
+        }
+      }
+      proxy->active = num_active;
+      active[num_active++] = endpoint.proxy;
+    } else if (proxy->active != NOT_ACTIVE) {
+      // NaN bounds can leave a maximum before its minimum
+      size_t last = active[--num_active];
+      active[proxy->active] = last;
+      broadphase->proxies[last].active = proxy->active;
+      proxy->active = NOT_ACTIVE;
+    }
+  }
+}
+
+static bool aabb_contains(aabb_t outer, aabb_t inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+/**
+ * Moves a proxy's leaf to the right tree and refits it if the body has left
+ * its stored bounds. Static bodies are stored with exact bounds, since they
+ * rarely move, and moving bodies with padded ones, so they can move a little
+ * before their leaf has to be reinserted. Oversized proxies have no leaf.
+ *
+ * @param had_leaf whether the proxy had a leaf before its last refresh
+ */
+static void update_tree_proxy(broadphase_t *broadphase, size_t index,
+                              bool had_leaf) {
+  proxy_t *proxy = &broadphase->proxies[index];
+  bool is_static = body_is_static(proxy->body);
+
+  if (had_leaf) {
+    aabb_tree_t *tree = proxy_tree(broadphase, proxy);
+    if (!proxy->oversized && proxy->is_static == is_static &&
+        aabb_contains(aabb_tree_get_bounds(tree, proxy->leaf),
+                      proxy->bounds)) {
+      return;
+    }
+    aabb_tree_remove(tree, proxy->leaf);
+  }
+
+  proxy->is_static = is_static;
+  if (proxy->oversized) {
+    return;
+  }
+  aabb_t stored = proxy->bounds;
+  if (!is_static) {
+    vector_t margin = {TREE_FAT_MARGIN, TREE_FAT_MARGIN};
+    stored.min = vec_subtract(stored.min, margin);
+    stored.max = vec_add(stored.max, margin);
+  }
+  proxy->leaf =
+      aabb_tree_insert(proxy_tree(broadphase, proxy), stored, index);
+}
+
+/**
+ * Reports a leaf found by a tree query as a pair with the proxy being
+ * queried, if their exact bounds overlap.
+ * Pairs of two moving proxies are found from both sides, so they are only
+ * reported from the one with the lower index.
+ */
+static void add_tree_pair(size_t other, void *aux) {
+  broadphase_t *broadphase = aux;
+  size_t index = broadphase->query_proxy;
+  proxy_t *proxy = &broadphase->proxies[index];
+  proxy_t *found = &broadphase->proxies[other];
+
+  if (other == index || (!found->is_static && other < index)) {
+    return;
+  }
+  if (aabb_overlap(proxy->bounds, found->bounds)) {
+    add_pair(broadphase, index, other);
+  }
+}
+
+/**
+ * Queries both trees with the bounds of every moving proxy.
+ * Static proxies are never queried, so two static bodies never pair up.
+ * Oversized proxies are paired by find_oversized_pairs() instead.
+ */
+static void find_tree_pairs(broadphase_t *broadphase) {
+  for (size_t i = 0; i < broadphase->num_proxies; i++) {
+    proxy_t *proxy = &broadphase->proxies[i];
+    if (proxy->is_static || proxy->oversized) {
+      continue;
+    }
+    broadphase->query_proxy = i;
+    aabb_tree_query(broadphase->moving_tree, proxy->bounds, add_tree_pair,
+                    broadphase);
+    aabb_tree_query(broadphase->static_tree, proxy->bounds, add_tree_pair,
+                    broadphase);
+  }
+}
+
+void broadphase_update(broadphase_t *broadphase, list_t *bodies) {
+  size_t num_kept = 0;
+  if (broadphase->type != BROADPHASE_GRID) {
+    num_kept = sync_proxies(broadphase, bodies);
+  }
+
+  size_t num_bodies = list_size(bodies);
+  size_t old_capacity = broadphase->proxy_capacity;
+  broadphase->proxies =
+      grow_array(broadphase->proxies, &broadphase->proxy_capacity, num_bodies,
+                 sizeof(proxy_t));
+  if (broadphase->proxy_capacity != old_capacity) {
+    size_t capacity = broadphase->proxy_capacity;
+    free(broadphase->oversized);
+    free(broadphase->active);
+    free(broadphase->remap);
+    broadphase->oversized = malloc(sizeof(size_t) * capacity);
+    broadphase->active = malloc(sizeof(size_t) * capacity);
+    broadphase->remap = malloc(sizeof(size_t) * capacity);
+    assert(broadphase->oversized);
+    assert(broadphase->active);
+    assert(broadphase->remap);
+  }
+
+  broadphase->num_proxies = num_bodies;
+  broadphase->num_oversized = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    proxy_t *proxy = &broadphase->proxies[i];
+    proxy->body = list_get(bodies, i);
+    bool had_leaf = i < num_kept && !proxy->oversized;
+    proxy_compute(broadphase, proxy);
+    if (proxy->oversized) {
+      broadphase->oversized[broadphase->num_oversized++] = i;
+    }
+    if (broadphase->type == BROADPHASE_TREE) {
+      update_tree_proxy(broadphase, i, had_leaf);
+    }
+  }
+
+  broadphase->num_pairs = 0;
+  if (broadphase->type == BROADPHASE_GRID) {
+    fill_grid(broadphase);
+    find_grid_pairs(broadphase);
+    find_oversized_pairs(broadphase);
+  } else if (broadphase->type == BROADPHASE_SWEEP_AND_PRUNE) {
+    sort_endpoints(broadphase);
+    find_sweep_pairs(broadphase);
+  } else {
+    find_tree_pairs(broadphase);
+    find_oversized_pairs(broadphase);
+  }
+
+  if (broadphase->num_pairs > 0) {
+    qsort(broadphase->pairs, broadphase->num_pairs, sizeof(index_pair_t),
+          compare_pairs);
+  }
+}
+
+size_t broadphase_num_pairs(broadphase_t *broadphase) {
+  return broadphase->num_pairs;
+}
+
+pair_t broadphase_get_pair(broadphase_t *broadphase, size_t index) {
+  assert(index < broadphase->num_pairs);
+
+  index_pair_t pair = broadphase->pairs[index];
+  return (pair_t){broadphase->proxies[pair.first].body,
+                  broadphase->proxies[pair.second].body};
+}
+
+static void add_query_result(broadphase_t *broadphase, size_t index) {
+  broadphase->query_results =
+      grow_array(broadphase->query_results, &broadphase->query_capacity,
+                 broadphase->num_query_results + 1, sizeof(size_t));
+  broadphase->query_results[broadphase->num_query_results++] = index;
+}
+
+static void add_tree_result(size_t index, void *aux) {
+  add_query_result(aux, index);
+}
+
+static void find_oversized_results(broadphase_t *broadphase) {
+  for (size_t o = 0; o < broadphase->num_oversized; o++) {
+    add_query_result(broadphase, broadphase->oversized[o]);
+  }
+}
+
+/**
+ * Finds the proxies in the grid cells a box covers, plus the oversized ones.
+ * A proxy can share several cells with the box, so it is only found from
+ * the cell holding the lower-left corner of the overlap of their cell ranges.
+ * Boxes too big for the grid fall back to every proxy.
+ */
+static void find_grid_results(broadphase_t *broadphase, aabb_t bounds) {
+  long range[4];
+  if (!cell_range(broadphase, bounds, range)) {
+    for (size_t i = 0; i < broadphase->num_proxies; i++) {
+      add_query_result(broadphase, i);
+    }
+    return;
+  }
+
+  find_oversized_results(broadphase);
+  size_t *starts = broadphase->bucket_starts;
+  cell_entry_t *entries = broadphase->sorted_entries;
+  for (long x = range[0]; x <= range[2]; x++) {
+    for (long y = range[1]; y <= range[3]; y++) {
+      size_t bucket = cell_hash(x, y) & (broadphase->num_buckets - 1);
+      for (size_t e = starts[bucket]; e < starts[bucket + 1]; e++) {
+        if (entries[e].x != x || entries[e].y != y) {
+          continue;
+        }
+        proxy_t *proxy = &broadphase->proxies[entries[e].proxy];
+        long home_x = proxy->min_x > range[0] ? proxy->min_x : range[0];
+        long home_y = proxy->min_y > range[1] ? proxy->min_y : range[1];
+        if (x == home_x && y == home_y) {
+          add_query_result(broadphase, entries[e].proxy);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Finds the proxies whose x interval starts before the box ends, from the
+ * sorted endpoints.
+ */
+static void find_sweep_results(broadphase_t *broadphase, aabb_t bounds) {
+  for (size_t e = 0; e < broadphase->num_endpoints; e++) {
+    endpoint_t endpoint = broadphase->endpoints[e];
+    if (endpoint.value > bounds.max.x) {
+      break;
+    }
+    if (!endpoint.is_max) {
+      add_query_result(broadphase, endpoint.proxy);
+    }
+  }
+}
+
+static int compare_indices(const void *i1, const void *i2) {
+  size_t index1 = *(const size_t *)i1;
+  size_t index2 = *(const size_t *)i2;
+  return index1 < index2 ? -1 : index1 > index2;
+}
+
+/**
+ * Finds the bodies whose bounds overlap a box or, if segment is not NULL,
+ * are crossed by a segment inside the box, and adds them to a list in the
+ * order they were passed to broadphase_update().
+ */
+static void query(broadphase_t *broadphase, aabb_t bounds, vector_t *segment,
+                  list_t *found) {
+  broadphase->num_query_results = 0;
+  if (broadphase->num_proxies == 0) {
+    return;
+  }
+
+  // each kind of broadphase finds a superset of the bodies, checked below
+  if (broadphase->type == BROADPHASE_GRID) {
+    find_grid_results(broadphase, bounds);
+  } else if (broadphase->type == BROADPHASE_SWEEP_AND_PRUNE) {
+    find_sweep_results(broadphase, bounds);
+  } else if (segment != NULL) {
+    find_oversized_results(broadphase);
+    aabb_tree_query_segment(broadphase->moving_tree, segment[0], segment[1],
+                            add_tree_result, broadphase);
+    aabb_tree_query_segment(broadphase->static_tree, segment[0], segment[1],
+                            add_tree_result, broadphase);
+  } else {
+    find_oversized_results(broadphase);
+    aabb_tree_query(broadphase->moving_tree, bounds, add_tree_result,
+                    broadphase);
+    aabb_tree_query(broadphase->static_tree, bounds, add_tree_result,
+                    broadphase);
+  }
+
+  if (broadphase->num_query_results > 1) {
+    qsort(broadphase->query_results, broadphase->num_query_results,
+          sizeof(size_t), compare_indices);
+  }
+  for (size_t r = 0; r < broadphase->num_query_results; r++) {
+    proxy_t *proxy = &broadphase->proxies[broadphase->query_results[r]];
+    bool found_proxy =
+        segment != NULL
+            ? aabb_segment_overlap(proxy->bounds, segment[0], segment[1])
+            : aabb_overlap(proxy->bounds, bounds);
+    if (found_proxy) {
+      list_add(found, proxy->body);
+    }
+  }
+}
+
+void broadphase_query(broadphase_t *broadphase, aabb_t bounds,
+                      list_t *found) {
+  query(broadphase, bounds, NULL, found);
+}
+
+void broadphase_query_segment(broadphase_t *broadphase, vector_t start,
+                              vector_t end, list_t *found) {
+  aabb_t bounds = {{fmin(start.x, end.x), fmin(start.y, end.y)},
+                   {fmax(start.x, end.x), fmax(start.y, end.y)}};
+  vector_t segment[2] = {start, end};
+  query(broadphase, bounds, segment, found);
+}
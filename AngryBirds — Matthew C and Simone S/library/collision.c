@@ -1,132 +1,1523 @@
 #include "collision.h"
 #include "body.h"
+#include "projection.h"
 
 #include <assert.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+const double REFERENCE_EDGE_TOLERANCE = 1e-3;
+const size_t GJK_MAX_ITERATIONS = 32;
+const size_t EPA_MAX_POINTS = 64;
+const double EPA_TOLERANCE = 1e-6;
+const double GJK_TOLERANCE = 1e-12;
+const size_t COLLISION_BATCH_CHUNK = 64;
+const size_t COLLISION_PREFETCH_DISTANCE = 4;
+
+/**
+ * Returns a vector containing the minimum and maximum length projections of
+ * a polygon's vertices onto a unit axis. The vertices are read from the
+ * polygon's packed coordinates, so this runs project_points()'s SIMD kernel.
+ *
+ * @param polygon the polygon to project
+ * @param unit_axis the unit axis to project each vertex on
+ * @return a vector in the form (min, max) where `min` is the minimum
+ * projection length and `max` is the maximum projection length.
+ */
+static vector_t get_max_min_projections(polygon_t *polygon,
+                                        vector_t unit_axis) {
+  return project_points(polygon_get_xs(polygon), polygon_get_ys(polygon),
+                        polygon_get_num_vertices(polygon), unit_axis);
+}
+
+/**
+ * Determines whether two convex polygons intersect, testing the edge normals
+ * of the first polygon as separating axes.
+ * The normals are the first polygon's cached unit normals (see
+ * polygon_get_normals()), with parallel edges sharing one axis, and the
+ * vertices are read in place, so no memory is allocated.
+ *
+ * @param poly1 the first polygon
+ * @param poly2 the second polygon
+ * @param min_overlap the smallest overlap found so far, updated if one of
+ * the first shape's axes overlaps less
+ * @return whether the shapes are colliding, and if not, the axis that
+ * separates them
+ */
+static collision_info_t compare_collision(polygon_t *poly1, polygon_t *poly2,
+                                          double *min_overlap) {
+  vector_t collision_axis = {0, 0};
+  const vector_t *axes = polygon_get_normals(poly1);
+
+  for (size_t i = 0; i < polygon_get_num_normals(poly1); i++) {
+    vector_t unit_vec = axes[i];
+    vector_t shape1_proj = get_max_min_projections(poly1, unit_vec);
+    vector_t shape2_proj = get_max_min_projections(poly2, unit_vec);
+
+    if (shape1_proj.y < shape2_proj.x || shape2_proj.y < shape1_proj.x) {
+      collision_info_t ret = {false, unit_vec};
+      return ret;
+    }
+
+    // an axis stands in for its opposite too, so check both directions
+    double forward = shape1_proj.y - shape2_proj.x;
+    double backward = shape2_proj.y - shape1_proj.x;
+    if (forward > 0 && forward < *min_overlap) {
+      *min_overlap = forward;
+      collision_axis = unit_vec;
+    }
+    if (backward > 0 && backward < *min_overlap) {
+      *min_overlap = backward;
+      collision_axis = unit_vec;
+    }
+  }
+
+  collision_info_t ret = {true, collision_axis};
+  return ret;
+}
+
 /**
- * Returns a list of vectors representing the edges of a shape.
+ * Tests a circle against a polygon on one axis, tracking the axis of least
+ * overlap. The circle projects onto the axis as [c.n - r, c.n + r].
  *
- * @param shape the list of vectors representing the vertices of a shape
- * @return a list of vectors representing the edges of the shape
+ * @return whether the shapes overlap on the axis
  */
-static list_t *get_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
+static bool circle_polygon_axis(polygon_t *polygon, vector_t center,
+                                double radius, vector_t unit_axis,
+                                double *min_overlap,
+                                vector_t *collision_axis) {
+  vector_t shape_proj = get_max_min_projections(polygon, unit_axis);
+  double center_proj = vec_dot(center, unit_axis);
+  double circle_min = center_proj - radius;
+  double circle_max = center_proj + radius;
 
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    *vec =
-        vec_subtract(*(vector_t *)list_get(shape, i % list_size(shape)),
-                     *(vector_t *)list_get(shape, (i + 1) % list_size(shape)));
-    list_add(edges, vec);
+  if (shape_proj.y < circle_min || circle_max < shape_proj.x) {
+    return false;
   }
 
-  return edges;
+  double overlap = fmin(shape_proj.y - circle_min, circle_max - shape_proj.x);
+  if (overlap < *min_overlap) {
+    *min_overlap = overlap;
+    *collision_axis = unit_axis;
+  }
+  return true;
 }
 
 /**
- * Returns a vector containing the maximum and minimum length projections given
- * a unit axis and shape.
+ * Determines whether a circle intersects a convex polygon.
+ * Besides the polygon's edge normals, the only other axis that can separate
+ * them is the one from the polygon's closest vertex to the circle's center.
  *
- * @param shape the list of vectors representing the vertices of a shape
- * @param unit_axis the unit axis to project eeach vertex on
- * @return a vector in the form (max, min) where `max` is the maximum projection
- * length and `min` is the minimum projection length.
+ * @return whether the shapes are colliding, and if so, the axis of least
+ * overlap (not oriented), otherwise the axis that separates them
  */
-static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
-  double min = __DBL_MAX__;
-  double max = -min;
+static collision_info_t circle_polygon_collision(polygon_t *polygon,
+                                                 vector_t center,
+                                                 double radius) {
+  double min_overlap = __DBL_MAX__;
+  vector_t collision_axis = VEC_ZERO;
+  const vector_t *shape = polygon_get_vertices(polygon);
+  const vector_t *normals = polygon_get_normals(polygon);
+  vector_t closest = VEC_ZERO;
+  double closest_dist = __DBL_MAX__;
 
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *curr = list_get(shape, i);
-    double dot = vec_dot(*curr, unit_axis);
+  for (size_t i = 0; i < polygon_get_num_normals(polygon); i++) {
+    if (!circle_polygon_axis(polygon, center, radius, normals[i],
+                             &min_overlap, &collision_axis)) {
+      return (collision_info_t){false, normals[i]};
+    }
+  }
 
-    if (dot < min) {
-      min = dot;
+  for (size_t i = 0; i < polygon_get_num_vertices(polygon); i++) {
+    vector_t to_center = vec_subtract(center, shape[i]);
+    double dist = vec_dot(to_center, to_center);
+    if (dist < closest_dist) {
+      closest_dist = dist;
+      closest = shape[i];
     }
+  }
 
-    if (dot > max) {
-      max = dot;
+  // a center sitting exactly on a vertex is already inside the polygon
+  if (closest_dist > 0) {
+    vector_t axis = vec_subtract(center, closest);
+    vector_t unit_vec = vec_multiply(1 / sqrt(closest_dist), axis);
+    if (!circle_polygon_axis(polygon, center, radius, unit_vec,
+                             &min_overlap, &collision_axis)) {
+      return (collision_info_t){false, unit_vec};
     }
   }
 
-  return (vector_t){min, max};
+  return (collision_info_t){true, collision_axis};
+}
+
+/**
+ * A rectangle described by its center, its two unit normals and how far it
+ * reaches along each, so it can be tested on two axes with a few dot
+ * products instead of projecting its vertices.
+ */
+typedef struct {
+  vector_t center;
+  vector_t axes[2];
+  double half_extents[2];
+} oriented_box_t;
+
+/**
+ * Reads a rectangle (see polygon_is_box()) as an oriented box. Its center
+ * is its centroid, so this only reads the polygon's pose, not its vertices.
+ */
+static oriented_box_t get_oriented_box(polygon_t *polygon) {
+  const vector_t *normals = polygon_get_normals(polygon);
+  vector_t half_extents = polygon_get_half_extents(polygon);
+  return (oriented_box_t){polygon_get_center(polygon),
+                          {normals[0], normals[1]},
+                          {half_extents.x, half_extents.y}};
+}
+
+/**
+ * Gets how far a box reaches from its center along a unit axis.
+ */
+static double box_reach(const oriented_box_t *box, vector_t unit_axis) {
+  return box->half_extents[0] * fabs(vec_dot(box->axes[0], unit_axis)) +
+         box->half_extents[1] * fabs(vec_dot(box->axes[1], unit_axis));
 }
 
 /**
- * Determines whether two convex polygons intersect.
- * The polygons are given as lists of vertices in counterclockwise order.
- * There is an edge between each pair of consecutive vertices,
- * and one between the first vertex and the last vertex.
+ * Tests two boxes on the axes of the first, like compare_collision() does
+ * for any two polygons.
  *
- * @param shape1 the first shape
- * @param shape2 the second shape
- * @return whether the shapes are colliding
+ * @param min_overlap the smallest overlap found so far, updated if one of
+ * the first box's axes overlaps less
+ * @return whether the boxes overlap on both axes, and if not, the axis that
+ * separates them
  */
-static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
-                                          double *min_overlap) {
-  list_t *edges1 = get_edges(shape1);
-  vector_t collision_axis = {0, 0};
+static collision_info_t box_axes_collision(const oriented_box_t *box1,
+                                           const oriented_box_t *box2,
+                                           double *min_overlap) {
+  vector_t collision_axis = VEC_ZERO;
+  vector_t offset = vec_subtract(box2->center, box1->center);
 
-  for (size_t i = 0; i < list_size(edges1); i++) {
+  for (size_t i = 0; i < 2; i++) {
+    vector_t axis = box1->axes[i];
+    double reach = box1->half_extents[i] + box_reach(box2, axis);
+    double distance = vec_dot(offset, axis);
+    // how far the shadows overlap, with the second box's past either end
+    double forward = reach - distance;
+    double backward = reach + distance;
+    if (forward < 0 || backward < 0) {
+      return (collision_info_t){false, axis};
+    }
 
-    vector_t *edge = list_get(edges1, i);
+    if (forward > 0 && forward < *min_overlap) {
+      *min_overlap = forward;
+      collision_axis = axis;
+    }
+    if (backward > 0 && backward < *min_overlap) {
+      *min_overlap = backward;
+      collision_axis = axis;
+    }
+  }
+  return (collision_info_t){true, collision_axis};
+}
 
-    vector_t axis = {-1 * edge->y, edge->x};
-    double unit_recip = 1 / vec_get_length(axis);
-    vector_t unit_vec = vec_multiply(unit_recip, axis);
+/**
+ * Determines whether two rectangles intersect, testing just the two axes of
+ * each.
+ *
+ * @return whether the boxes are colliding, and if so, the axis of least
+ * overlap (not oriented), otherwise the axis that separates them
+ */
+static collision_info_t box_box_collision(polygon_t *poly1,
+                                          polygon_t *poly2) {
+  oriented_box_t box1 = get_oriented_box(poly1);
+  oriented_box_t box2 = get_oriented_box(poly2);
+  double overlap1 = __DBL_MAX__;
+  double overlap2 = __DBL_MAX__;
 
-    vector_t shape1_proj = get_max_min_projections(shape1, unit_vec);
-    vector_t shape2_proj = get_max_min_projections(shape2, unit_vec);
+  collision_info_t collision1 = box_axes_collision(&box1, &box2, &overlap1);
+  if (!collision1.collided) {
+    return collision1;
+  }
+  collision_info_t collision2 = box_axes_collision(&box2, &box1, &overlap2);
+  if (!collision2.collided) {
+    return collision2;
+  }
+  return overlap1 < overlap2 ? collision1 : collision2;
+}
 
-    if (shape1_proj.y < shape2_proj.x || shape2_proj.y < shape1_proj.x) {
-      list_free(edges1);
-      collision_info_t ret = {false, collision_axis};
-      return ret;
+/**
+ * Determines whether a circle intersects a rectangle, on the same axes as
+ * circle_polygon_collision(): the box's two axes, and the one from its
+ * nearest corner to the circle's center.
+ *
+ * @return whether the shapes are colliding, and if so, the axis of least
+ * overlap (not oriented), otherwise the axis that separates them
+ */
+static collision_info_t box_circle_collision(polygon_t *polygon,
+                                             vector_t center, double radius) {
+  oriented_box_t box = get_oriented_box(polygon);
+  vector_t offset = vec_subtract(center, box.center);
+  double min_overlap = __DBL_MAX__;
+  vector_t collision_axis = VEC_ZERO;
+  vector_t corner = box.center;
+
+  for (size_t i = 0; i < 2; i++) {
+    double distance = vec_dot(offset, box.axes[i]);
+    double overlap = box.half_extents[i] + radius - fabs(distance);
+    if (overlap < 0) {
+      return (collision_info_t){false, box.axes[i]};
+    }
+    if (overlap < min_overlap) {
+      min_overlap = overlap;
+      collision_axis = box.axes[i];
     }
+    // the nearest corner is on the circle's side of both axes
+    double side = distance < 0 ? -box.half_extents[i] : box.half_extents[i];
+    corner = vec_add(corner, vec_multiply(side, box.axes[i]));
+  }
 
-    if ((shape1_proj.y > shape2_proj.x) &&
-        (shape1_proj.y - shape2_proj.x) < *min_overlap) {
-      *min_overlap = shape1_proj.y - shape2_proj.x;
-      collision_axis = unit_vec;
-    } else if ((shape2_proj.y > shape1_proj.x) &&
-               (shape2_proj.y - shape1_proj.x) < *min_overlap) {
-      *min_overlap = shape2_proj.y - shape1_proj.x;
-      collision_axis = unit_vec;
+  // a center sitting exactly on a corner is already inside the box
+  vector_t to_center = vec_subtract(center, corner);
+  double length = vec_get_length(to_center);
+  if (length > 0) {
+    vector_t axis = vec_multiply(1 / length, to_center);
+    double overlap =
+        box_reach(&box, axis) + radius - fabs(vec_dot(offset, axis));
+    if (overlap < 0) {
+      return (collision_info_t){false, axis};
+    }
+    if (overlap < min_overlap) {
+      collision_axis = axis;
     }
   }
+  return (collision_info_t){true, collision_axis};
+}
 
-  list_free(edges1);
-  collision_info_t ret = {true, collision_axis};
-  return ret;
+/**
+ * Determines whether two circles intersect.
+ *
+ * @return whether the circles are colliding, and the unit axis from the
+ * first center to the second
+ */
+static collision_info_t circle_circle_collision(vector_t center1,
+                                                double radius1,
+                                                vector_t center2,
+                                                double radius2) {
+  vector_t diff = vec_subtract(center2, center1);
+  double dist = vec_get_length(diff);
+
+  if (dist > radius1 + radius2) {
+    return (collision_info_t){false, vec_multiply(1 / dist, diff)};
+  }
+  // concentric circles have no preferred axis, so pick one
+  if (dist == 0) {
+    return (collision_info_t){true, (vector_t){1, 0}};
+  }
+  return (collision_info_t){true, vec_multiply(1 / dist, diff)};
 }
 
-collision_info_t find_collision(body_t *body1, body_t *body2) {
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
+/**
+ * Points a collision's axis from the first body's center towards the
+ * second's, as find_collision() promises. Cached normals and the axes of
+ * least overlap can face either way.
+ */
+static collision_info_t orient_collision(collision_info_t collision,
+                                         vector_t center1, vector_t center2) {
+  if (collision.collided &&
+      vec_dot(collision.axis, vec_subtract(center2, center1)) < 0) {
+    collision.axis = vec_negate(collision.axis);
+  }
+  return collision;
+}
 
-  double c1_overlap = __DBL_MAX__;
-  double c2_overlap = __DBL_MAX__;
+bool aabb_overlap(aabb_t aabb1, aabb_t aabb2) {
+  return aabb1.min.x <= aabb2.max.x && aabb2.min.x <= aabb1.max.x &&
+         aabb1.min.y <= aabb2.max.y && aabb2.min.y <= aabb1.max.y;
+}
 
-  collision_info_t collision1 = compare_collision(shape1, shape2, &c1_overlap);
-  collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
+bool aabb_segment_overlap(aabb_t aabb, vector_t start, vector_t end) {
+  double starts[2] = {start.x, start.y};
+  double deltas[2] = {end.x - start.x, end.y - start.y};
+  double mins[2] = {aabb.min.x, aabb.min.y};
+  double maxs[2] = {aabb.max.x, aabb.max.y};
 
-  list_free(shape1);
-  list_free(shape2);
+  // clip the segment to the slab between the box's sides on each axis
+  double enter = 0;
+  double exit = 1;
+  for (size_t i = 0; i < 2; i++) {
+    if (deltas[i] == 0) {
+      if (starts[i] < mins[i] || starts[i] > maxs[i]) {
+        return false;
+      }
+      continue;
+    }
+    double time1 = (mins[i] - starts[i]) / deltas[i];
+    double time2 = (maxs[i] - starts[i]) / deltas[i];
+    enter = fmax(enter, fmin(time1, time2));
+    exit = fmin(exit, fmax(time1, time2));
+    if (enter > exit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Gets the unit normal of a half-plane body, facing out of it.
+ */
+static vector_t half_plane_normal(body_t *body) {
+  return polygon_get_normals(body_get_collision_polygon(body))[0];
+}
 
+/**
+ * Projects a body's collision shape onto a unit axis.
+ * A half-plane only ends on its own normal's axis; on any other axis its
+ * projection reaches out to +/-__DBL_MAX__.
+ *
+ * @return the (min, max) of the projection
+ */
+static vector_t project_body(body_t *body, vector_t unit_axis) {
+  shape_type_t type = body_get_shape_type(body);
+  if (type == SHAPE_CIRCLE) {
+    double center = vec_dot(body_get_centroid(body), unit_axis);
+    double radius = body_get_radius(body);
+    return (vector_t){center - radius, center + radius};
+  }
+  if (type == SHAPE_HALF_PLANE) {
+    vector_t normal = half_plane_normal(body);
+    double boundary = vec_dot(body_get_centroid(body), unit_axis);
+    vector_t proj = {-__DBL_MAX__, __DBL_MAX__};
+    if (vec_cross(normal, unit_axis) == 0) {
+      if (vec_dot(normal, unit_axis) > 0) {
+        proj.y = boundary;
+      } else {
+        proj.x = boundary;
+      }
+    }
+    return proj;
+  }
+  return get_max_min_projections(body_get_collision_polygon(body), unit_axis);
+}
+
+/**
+ * Finds how far a body reaches into a half-plane, past its boundary.
+ *
+ * @return the depth, which is negative if the body is clear of the
+ * half-plane, and -__DBL_MAX__ if the body is a half-plane too
+ */
+static double half_plane_depth(body_t *plane, body_t *other) {
+  if (body_get_shape_type(other) == SHAPE_HALF_PLANE) {
+    return -__DBL_MAX__;
+  }
+  vector_t normal = half_plane_normal(plane);
+  return vec_dot(body_get_centroid(plane), normal) -
+         project_body(other, normal).x;
+}
+
+/**
+ * Determines whether a half-plane and another body intersect, which only
+ * takes projecting the other body onto the half-plane's normal.
+ * Either body may be the half-plane.
+ *
+ * @return whether the bodies are colliding, and the half-plane's normal,
+ * pointing from body1 towards body2
+ */
+static collision_info_t half_plane_collision(body_t *body1, body_t *body2) {
+  bool plane_first = body_get_shape_type(body1) == SHAPE_HALF_PLANE;
+  body_t *plane = plane_first ? body1 : body2;
+  body_t *other = plane_first ? body2 : body1;
+  if (body_get_shape_type(other) == SHAPE_HALF_PLANE) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
+
+  vector_t normal = half_plane_normal(plane);
+  bool collided = half_plane_depth(plane, other) >= 0;
+  return (collision_info_t){collided,
+                            plane_first ? normal : vec_negate(normal)};
+}
+
+/**
+ * The kernels find_collision() picks between, by the shapes of the bodies.
+ */
+typedef enum {
+  COLLIDE_HALF_PLANE,
+  COLLIDE_CIRCLES,
+  COLLIDE_BOX_CIRCLE,
+  COLLIDE_POLYGON_CIRCLE,
+  COLLIDE_BOXES,
+  COLLIDE_POLYGONS,
+  NUM_COLLISION_KINDS
+} collision_kind_t;
+
+static collision_kind_t get_collision_kind(body_t *body1, body_t *body2) {
+  shape_type_t type1 = body_get_shape_type(body1);
+  shape_type_t type2 = body_get_shape_type(body2);
+  if (type1 == SHAPE_HALF_PLANE || type2 == SHAPE_HALF_PLANE) {
+    return COLLIDE_HALF_PLANE;
+  }
+  if (type1 == SHAPE_CIRCLE && type2 == SHAPE_CIRCLE) {
+    return COLLIDE_CIRCLES;
+  }
+  if (type1 == SHAPE_CIRCLE || type2 == SHAPE_CIRCLE) {
+    body_t *other = type1 == SHAPE_CIRCLE ? body2 : body1;
+    return polygon_is_box(body_get_collision_polygon(other))
+               ? COLLIDE_BOX_CIRCLE
+               : COLLIDE_POLYGON_CIRCLE;
+  }
+  if (polygon_is_box(body_get_collision_polygon(body1)) &&
+      polygon_is_box(body_get_collision_polygon(body2))) {
+    return COLLIDE_BOXES;
+  }
+  return COLLIDE_POLYGONS;
+}
+
+/**
+ * Runs the kernel for a pair of bodies whose bounding boxes overlap.
+ */
+static collision_info_t collide_kind(collision_kind_t kind, body_t *body1,
+                                     body_t *body2) {
+  if (kind == COLLIDE_HALF_PLANE) {
+    return half_plane_collision(body1, body2);
+  }
+  vector_t center1 = body_get_centroid(body1);
+  vector_t center2 = body_get_centroid(body2);
+
+  if (kind == COLLIDE_CIRCLES) {
+    return circle_circle_collision(center1, body_get_radius(body1), center2,
+                                   body_get_radius(body2));
+  }
+
+  if (kind == COLLIDE_BOX_CIRCLE || kind == COLLIDE_POLYGON_CIRCLE) {
+    bool circle_first = body_get_shape_type(body1) == SHAPE_CIRCLE;
+    body_t *circle = circle_first ? body1 : body2;
+    body_t *other = circle_first ? body2 : body1;
+    polygon_t *polygon = body_get_collision_polygon(other);
+    collision_info_t collision =
+        kind == COLLIDE_BOX_CIRCLE
+            ? box_circle_collision(polygon, body_get_centroid(circle),
+                                   body_get_radius(circle))
+            : circle_polygon_collision(polygon, body_get_centroid(circle),
+                                       body_get_radius(circle));
+    return orient_collision(collision, center1, center2);
+  }
+
+  // read the bodies' vertices in place rather than copying body_get_shape()
+  polygon_t *poly1 = body_get_collision_polygon(body1);
+  polygon_t *poly2 = body_get_collision_polygon(body2);
+  if (kind == COLLIDE_BOXES) {
+    return orient_collision(box_box_collision(poly1, poly2), center1,
+                            center2);
+  }
+
+  double c1_overlap = __DBL_MAX__;
+  double c2_overlap = __DBL_MAX__;
+
+  collision_info_t collision1 = compare_collision(poly1, poly2, &c1_overlap);
   if (!collision1.collided) {
     return collision1;
   }
 
+  collision_info_t collision2 = compare_collision(poly2, poly1, &c2_overlap);
   if (!collision2.collided) {
     return collision2;
   }
 
   if (c1_overlap < c2_overlap) {
-    return collision1;
+    return orient_collision(collision1, center1, center2);
+  }
+  return orient_collision(collision2, center1, center2);
+}
+
+collision_info_t find_collision(body_t *body1, body_t *body2) {
+  if (!aabb_overlap(body_get_aabb(body1), body_get_aabb(body2))) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
+  return collide_kind(get_collision_kind(body1, body2), body1, body2);
+}
+
+/**
+ * Asks for the vertices a pair will read to be loaded into the cache ahead
+ * of time, where the compiler can do that. Only the kernels that read
+ * vertices are prefetched for, since getting a polygon's vertices moves them
+ * into the world, which circles and boxes never need.
+ */
+static void prefetch_pair(pair_t pair, collision_kind_t kind) {
+#if defined(__GNUC__) || defined(__clang__)
+  if (kind == COLLIDE_POLYGONS) {
+    polygon_t *poly1 = body_get_collision_polygon(pair.body1);
+    polygon_t *poly2 = body_get_collision_polygon(pair.body2);
+    __builtin_prefetch(polygon_get_xs(poly1));
+    __builtin_prefetch(polygon_get_ys(poly1));
+    __builtin_prefetch(polygon_get_xs(poly2));
+    __builtin_prefetch(polygon_get_ys(poly2));
+  } else if (kind == COLLIDE_POLYGON_CIRCLE) {
+    body_t *other = body_get_shape_type(pair.body1) == SHAPE_CIRCLE
+                        ? pair.body2
+                        : pair.body1;
+    __builtin_prefetch(
+        polygon_get_vertices(body_get_collision_polygon(other)));
+  }
+#else
+  (void)pair;
+  (void)kind;
+#endif
+}
+
+void find_collisions_batch(const pair_t *pairs, size_t num_pairs,
+                           collision_info_t *out) {
+  // pairs are sorted by kernel a chunk at a time, on the stack
+  size_t order[COLLISION_BATCH_CHUNK];
+  collision_kind_t kinds[COLLISION_BATCH_CHUNK];
+
+  for (size_t chunk = 0; chunk < num_pairs; chunk += COLLISION_BATCH_CHUNK) {
+    size_t size = num_pairs - chunk;
+    if (size > COLLISION_BATCH_CHUNK) {
+      size = COLLISION_BATCH_CHUNK;
+    }
+
+    // the boxes reject most pairs before the shapes are even looked at
+    size_t counts[NUM_COLLISION_KINDS + 1] = {0};
+    for (size_t i = 0; i < size; i++) {
+      pair_t pair = pairs[chunk + i];
+      if (!aabb_overlap(body_get_aabb(pair.body1),
+                        body_get_aabb(pair.body2))) {
+        out[chunk + i] = (collision_info_t){false, VEC_ZERO};
+        kinds[i] = NUM_COLLISION_KINDS;
+        continue;
+      }
+      kinds[i] = get_collision_kind(pair.body1, pair.body2);
+      counts[kinds[i] + 1]++;
+    }
+
+    // a counting sort, keeping pairs in order within each kernel
+    for (size_t k = 1; k <= NUM_COLLISION_KINDS; k++) {
+      counts[k] += counts[k - 1];
+    }
+    size_t num_tests = counts[NUM_COLLISION_KINDS];
+    for (size_t i = 0; i < size; i++) {
+      if (kinds[i] != NUM_COLLISION_KINDS) {
+        order[counts[kinds[i]]++] = i;
+      }
+    }
+
+    for (size_t j = 0; j < num_tests; j++) {
+      if (j + COLLISION_PREFETCH_DISTANCE < num_tests) {
+        size_t ahead = order[j + COLLISION_PREFETCH_DISTANCE];
+        prefetch_pair(pairs[chunk + ahead], kinds[ahead]);
+      }
+      size_t i = order[j];
+      pair_t pair = pairs[chunk + i];
+      out[chunk + i] = collide_kind(kinds[i], pair.body1, pair.body2);
+    }
+  }
+}
+
+/**
+ * The support function of a body's core: the point of it furthest along a
+ * direction. A circle's core is its center, and the radius is added back
+ * as a margin around it, so GJK works on polygons and points only and
+ * finishes exactly in a few steps.
+ */
+static vector_t core_support(body_t *body, vector_t dir) {
+  if (body_get_shape_type(body) == SHAPE_CIRCLE) {
+    return body_get_centroid(body);
+  }
+
+  polygon_t *polygon = body_get_collision_polygon(body);
+  const double *xs = polygon_get_xs(polygon);
+  const double *ys = polygon_get_ys(polygon);
+  size_t best = 0;
+  double best_dot = -__DBL_MAX__;
+  for (size_t i = 0; i < polygon_get_num_vertices(polygon); i++) {
+    double dot = xs[i] * dir.x + ys[i] * dir.y;
+    if (dot > best_dot) {
+      best_dot = dot;
+      best = i;
+    }
+  }
+  return (vector_t){xs[best], ys[best]};
+}
+
+/**
+ * The support function of the Minkowski difference of two bodies' cores,
+ * core1 - core2. The cores overlap exactly when it contains the origin,
+ * and otherwise the distance between them is its distance from the origin.
+ */
+static vector_t minkowski_support(body_t *body1, body_t *body2,
+                                  vector_t dir) {
+  return vec_subtract(core_support(body1, dir),
+                      core_support(body2, vec_negate(dir)));
+}
+
+/**
+ * Finds the point of a segment closest to the origin.
+ *
+ * @param simplex the segment's ends, cut down to the end closest to the
+ * origin if that is the closest point
+ * @param num_points set to the number of points left (1 or 2)
+ */
+static vector_t closest_on_segment(vector_t *simplex, size_t *num_points) {
+  vector_t edge = vec_subtract(simplex[1], simplex[0]);
+  double length_sq = vec_dot(edge, edge);
+  double t = length_sq == 0 ? 0 : -vec_dot(simplex[0], edge) / length_sq;
+  if (t <= 0) {
+    *num_points = 1;
+    return simplex[0];
+  }
+  if (t >= 1) {
+    simplex[0] = simplex[1];
+    *num_points = 1;
+    return simplex[0];
+  }
+  *num_points = 2;
+  return vec_add(simplex[0], vec_multiply(t, edge));
+}
+
+/**
+ * Finds the point of a GJK simplex closest to the origin, and cuts the
+ * simplex down to the smallest part of it containing that point.
+ *
+ * @param simplex the simplex's points, updated in place
+ * @param num_points the number of points (1 to 3), updated in place
+ * @param contains set to whether the simplex is a triangle containing
+ * the origin
+ * @return the closest point
+ */
+static vector_t closest_on_simplex(vector_t *simplex, size_t *num_points,
+                                   bool *contains) {
+  *contains = false;
+  if (*num_points == 1) {
+    return simplex[0];
+  }
+  if (*num_points == 2) {
+    return closest_on_segment(simplex, num_points);
+  }
+
+  // the origin is inside if it is on the same side of every edge
+  double sides[3];
+  for (size_t i = 0; i < 3; i++) {
+    vector_t edge = vec_subtract(simplex[(i + 1) % 3], simplex[i]);
+    sides[i] = vec_cross(edge, vec_negate(simplex[i]));
+  }
+  if ((sides[0] >= 0 && sides[1] >= 0 && sides[2] >= 0) ||
+      (sides[0] <= 0 && sides[1] <= 0 && sides[2] <= 0)) {
+    *contains = true;
+    return VEC_ZERO;
   }
-  return collision2;
+
+  // otherwise the closest point is on one of the edges
+  vector_t best = VEC_ZERO;
+  double best_dist = __DBL_MAX__;
+  vector_t best_edge[2];
+  size_t best_num_points = 0;
+  for (size_t i = 0; i < 3; i++) {
+    vector_t edge[2] = {simplex[i], simplex[(i + 1) % 3]};
+    size_t edge_points;
+    vector_t closest = closest_on_segment(edge, &edge_points);
+    double dist = vec_dot(closest, closest);
+    if (dist < best_dist) {
+      best_dist = dist;
+      best = closest;
+      best_edge[0] = edge[0];
+      best_edge[1] = edge[1];
+      best_num_points = edge_points;
+    }
+  }
+  simplex[0] = best_edge[0];
+  simplex[1] = best_edge[1];
+  *num_points = best_num_points;
+  return best;
+}
+
+/**
+ * Finds the distance between two bodies' cores with GJK, by walking a
+ * simplex of support points of their Minkowski difference towards the
+ * origin.
+ *
+ * @param simplex set to the last simplex, a triangle containing the origin
+ * if the cores overlap
+ * @param num_points set to the number of points in the simplex
+ * @param closest set to the point of the difference closest to the origin,
+ * i.e. the offset from core2 to core1 at their closest
+ * @param max_dist the distance past which the exact distance isn't needed
+ * @return whether the cores overlap
+ */
+static bool gjk(body_t *body1, body_t *body2, vector_t simplex[3],
+                size_t *num_points, vector_t *closest, double max_dist) {
+  vector_t dir = vec_subtract(body_get_centroid(body1),
+                              body_get_centroid(body2));
+  if (dir.x == 0 && dir.y == 0) {
+    dir = (vector_t){1, 0};
+  }
+  simplex[0] = minkowski_support(body1, body2, dir);
+  *num_points = 1;
+  *closest = simplex[0];
+
+  for (size_t i = 0; i < GJK_MAX_ITERATIONS; i++) {
+    double dist_sq = vec_dot(*closest, *closest);
+    if (dist_sq == 0) {
+      return true;
+    }
+    vector_t point = minkowski_support(body1, body2, vec_negate(*closest));
+    // how far the difference reaches towards the origin past that point
+    double bound = vec_dot(point, *closest);
+    if (bound > max_dist * sqrt(dist_sq)) {
+      return false;
+    }
+    if (dist_sq - bound <= GJK_TOLERANCE * dist_sq) {
+      return false;
+    }
+
+    simplex[(*num_points)++] = point;
+    bool contains;
+    *closest = closest_on_simplex(simplex, num_points, &contains);
+    if (contains) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Grows a triangle containing the origin out to the edge of the Minkowski
+ * difference of two bodies' cores nearest the origin, adding the support
+ * point beyond the nearest edge until no point lies further out than it.
+ *
+ * @param simplex a triangle from gjk() that contains the origin
+ * @return the unit normal of the nearest edge, facing out of the difference
+ */
+static vector_t epa(body_t *body1, body_t *body2, const vector_t *simplex) {
+  vector_t points[EPA_MAX_POINTS];
+  size_t num_points = 3;
+  points[0] = simplex[0];
+  // wind counterclockwise, so each edge's outward normal is on its right
+  bool clockwise = vec_cross(vec_subtract(simplex[1], simplex[0]),
+                             vec_subtract(simplex[2], simplex[0])) < 0;
+  points[1] = clockwise ? simplex[2] : simplex[1];
+  points[2] = clockwise ? simplex[1] : simplex[2];
+
+  while (true) {
+    double min_dist = __DBL_MAX__;
+    size_t nearest = 0;
+    vector_t normal = {1, 0};
+    for (size_t i = 0; i < num_points; i++) {
+      vector_t edge =
+          vec_subtract(points[(i + 1) % num_points], points[i]);
+      double length = vec_get_length(edge);
+      if (length == 0) {
+        continue;
+      }
+      vector_t out = vec_multiply(1 / length, (vector_t){edge.y, -edge.x});
+      double dist = vec_dot(out, points[i]);
+      if (dist < min_dist) {
+        min_dist = dist;
+        nearest = i;
+        normal = out;
+      }
+    }
+
+    vector_t point = minkowski_support(body1, body2, normal);
+    if (vec_dot(point, normal) - min_dist < EPA_TOLERANCE ||
+        num_points == EPA_MAX_POINTS) {
+      return normal;
+    }
+    for (size_t i = num_points; i > nearest + 1; i--) {
+      points[i] = points[i - 1];
+    }
+    points[nearest + 1] = point;
+    num_points++;
+  }
+}
+
+collision_info_t find_collision_gjk(body_t *body1, body_t *body2) {
+  if (!aabb_overlap(body_get_aabb(body1), body_get_aabb(body2))) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
+  // a half-plane has no support point along most directions
+  if (body_get_shape_type(body1) == SHAPE_HALF_PLANE ||
+      body_get_shape_type(body2) == SHAPE_HALF_PLANE) {
+    return half_plane_collision(body1, body2);
+  }
+
+  double margin = body_get_radius(body1) + body_get_radius(body2);
+  vector_t simplex[3] = {{0, 0}, {0, 0}, {0, 0}};
+  size_t num_points;
+  vector_t closest;
+  vector_t center1 = body_get_centroid(body1);
+  vector_t center2 = body_get_centroid(body2);
+
+  if (!gjk(body1, body2, simplex, &num_points, &closest, margin)) {
+    // the cores are apart, so the radii have to make up the gap
+    double dist = vec_get_length(closest);
+    if (dist > margin) {
+      return (collision_info_t){false, vec_multiply(1 / dist, closest)};
+    }
+    return (collision_info_t){true, vec_multiply(-1 / dist, closest)};
+  }
+
+  vector_t edge = vec_subtract(simplex[1], simplex[0]);
+  vector_t axis;
+  if (num_points == 3 &&
+      vec_cross(edge, vec_subtract(simplex[2], simplex[0])) != 0) {
+    axis = epa(body1, body2, simplex);
+  } else if (num_points >= 2 && vec_get_length(edge) > 0) {
+    // the origin is on an edge of the difference, so the cores just touch
+    axis = vec_multiply(1 / vec_get_length(edge),
+                        (vector_t){-edge.y, edge.x});
+  } else {
+    axis = vec_subtract(center2, center1);
+    double length = vec_get_length(axis);
+    axis = length == 0 ? (vector_t){1, 0} : vec_multiply(1 / length, axis);
+  }
+  return orient_collision((collision_info_t){true, axis}, center1, center2);
+}
+
+collision_info_t find_collision_with(narrowphase_type_t type, body_t *body1,
+                                     body_t *body2) {
+  if (type == NARROWPHASE_GJK) {
+    return find_collision_gjk(body1, body2);
+  }
+  return find_collision(body1, body2);
+}
+
+/**
+ * Returns the average of a polygon's vertices, which is inside the polygon.
+ */
+static vector_t vertex_average(const vector_t *shape, size_t size) {
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < size; i++) {
+    sum = vec_add(sum, shape[i]);
+  }
+  return vec_multiply(1.0 / size, sum);
+}
+
+/**
+ * Returns the unit normal of the edge from a polygon's i-th vertex to the
+ * next one, facing out of the polygon. The vertices may go either way
+ * around, so the normal is faced away from a point inside the polygon.
+ * Returns the zero vector for an edge of length 0.
+ */
+static vector_t outward_normal(const vector_t *shape, size_t size, size_t i,
+                               vector_t inside) {
+  vector_t curr = shape[i];
+  vector_t next = shape[(i + 1) % size];
+  vector_t edge = vec_subtract(next, curr);
+  double length = vec_get_length(edge);
+  if (length == 0) {
+    return VEC_ZERO;
+  }
+
+  vector_t normal = vec_multiply(1 / length, (vector_t){edge.y, -edge.x});
+  if (vec_dot(normal, vec_subtract(curr, inside)) < 0) {
+    normal = vec_negate(normal);
+  }
+  return normal;
+}
+
+/**
+ * Finds the edge of a polygon whose outward normal faces furthest along a
+ * direction.
+ *
+ * @param alignment set to the dot product of that edge's normal with the
+ * direction
+ * @return the index of the edge's first vertex
+ */
+static size_t find_facing_edge(const vector_t *shape, size_t size,
+                               vector_t inside, vector_t dir,
+                               double *alignment) {
+  size_t best = 0;
+  *alignment = -__DBL_MAX__;
+  for (size_t i = 0; i < size; i++) {
+    double dot = vec_dot(outward_normal(shape, size, i, inside), dir);
+    if (dot > *alignment) {
+      *alignment = dot;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/**
+ * Clips a segment to the side of a line where dot(p, dir) >= offset.
+ *
+ * @param points the ends of the segment, replaced by the clipped segment
+ * @return the number of points left (0 or 2)
+ */
+static size_t clip_segment(vector_t points[2], vector_t dir, double offset) {
+  double dist1 = vec_dot(points[0], dir) - offset;
+  double dist2 = vec_dot(points[1], dir) - offset;
+  if (dist1 < 0 && dist2 < 0) {
+    return 0;
+  }
+  if (dist1 < 0 || dist2 < 0) {
+    // replace the end outside the line with where the segment crosses it
+    vector_t cross = vec_add(
+        points[0], vec_multiply(dist1 / (dist1 - dist2),
+                                vec_subtract(points[1], points[0])));
+    points[dist1 < 0 ? 0 : 1] = cross;
+  }
+  return 2;
+}
+
+/**
+ * Finds where two colliding polygons touch by clipping, as described in
+ * find_contacts().
+ */
+static contact_manifold_t polygon_contacts(polygon_t *poly1, polygon_t *poly2,
+                                           vector_t normal) {
+  contact_manifold_t contacts = {normal, 0, 0, {VEC_ZERO}, {0}};
+  const vector_t *shape1 = polygon_get_vertices(poly1);
+  const vector_t *shape2 = polygon_get_vertices(poly2);
+  size_t size1 = polygon_get_num_vertices(poly1);
+  size_t size2 = polygon_get_num_vertices(poly2);
+  vector_t inside1 = vertex_average(shape1, size1);
+  vector_t inside2 = vertex_average(shape2, size2);
+
+  // the reference edge is whichever is most square to the collision axis;
+  // ties go to the first body so the choice doesn't flicker between ticks
+  double alignment1, alignment2;
+  size_t edge1 =
+      find_facing_edge(shape1, size1, inside1, normal, &alignment1);
+  size_t edge2 = find_facing_edge(shape2, size2, inside2, vec_negate(normal),
+                                  &alignment2);
+  bool flip = alignment2 > alignment1 + REFERENCE_EDGE_TOLERANCE;
+
+  const vector_t *ref_shape = flip ? shape2 : shape1;
+  const vector_t *inc_shape = flip ? shape1 : shape2;
+  size_t ref_size = flip ? size2 : size1;
+  size_t inc_size = flip ? size1 : size2;
+  size_t ref_edge = flip ? edge2 : edge1;
+  vector_t ref_normal =
+      outward_normal(ref_shape, ref_size, ref_edge, flip ? inside2 : inside1);
+  double inc_alignment;
+  size_t inc_edge =
+      find_facing_edge(inc_shape, inc_size, flip ? inside1 : inside2,
+                       vec_negate(ref_normal), &inc_alignment);
+
+  vector_t ref1 = ref_shape[ref_edge];
+  vector_t ref2 = ref_shape[(ref_edge + 1) % ref_size];
+  vector_t points[2] = {inc_shape[inc_edge],
+                        inc_shape[(inc_edge + 1) % inc_size]};
+
+  // keep the part of the incident edge alongside the reference edge
+  vector_t tangent = vec_subtract(ref2, ref1);
+  tangent = vec_multiply(1 / vec_get_length(tangent), tangent);
+  if (clip_segment(points, tangent, vec_dot(ref1, tangent)) == 0 ||
+      clip_segment(points, vec_negate(tangent), -vec_dot(ref2, tangent)) ==
+          0) {
+    return contacts;
+  }
+
+  for (size_t i = 0; i < 2; i++) {
+    double separation = vec_dot(ref_normal, vec_subtract(points[i], ref1));
+    if (separation > 0) {
+      continue;
+    }
+    size_t n = contacts.num_points++;
+    contacts.points[n] =
+        vec_subtract(points[i], vec_multiply(separation / 2, ref_normal));
+    contacts.depths[n] = -separation;
+    if (-separation > contacts.depth) {
+      contacts.depth = -separation;
+    }
+  }
+  return contacts;
+}
+
+/**
+ * Finds where a body touches a half-plane: a circle at its deepest point,
+ * and a polygon at its (up to two) deepest vertices past the boundary.
+ * Either body may be the half-plane.
+ */
+static contact_manifold_t half_plane_contacts(body_t *body1, body_t *body2,
+                                              vector_t normal) {
+  contact_manifold_t contacts = {normal, 0, 0, {VEC_ZERO}, {0}};
+  bool plane_first = body_get_shape_type(body1) == SHAPE_HALF_PLANE;
+  body_t *plane = plane_first ? body1 : body2;
+  body_t *other = plane_first ? body2 : body1;
+  vector_t plane_normal = half_plane_normal(plane);
+
+  if (body_get_shape_type(other) == SHAPE_CIRCLE) {
+    contacts.depth = half_plane_depth(plane, other);
+    contacts.num_points = 1;
+    contacts.depths[0] = contacts.depth;
+    double reach = body_get_radius(other) - contacts.depth / 2;
+    contacts.points[0] = vec_subtract(body_get_centroid(other),
+                                      vec_multiply(reach, plane_normal));
+    return contacts;
+  }
+
+  polygon_t *polygon = body_get_collision_polygon(other);
+  const vector_t *shape = polygon_get_vertices(polygon);
+  double boundary = vec_dot(plane_normal, body_get_centroid(plane));
+  for (size_t i = 0; i < polygon_get_num_vertices(polygon); i++) {
+    vector_t vertex = shape[i];
+    double depth = boundary - vec_dot(plane_normal, vertex);
+    if (depth < 0) {
+      continue;
+    }
+    // keep the two deepest, deepest first
+    size_t n = contacts.num_points;
+    if (n == 2 && depth <= contacts.depths[1]) {
+      continue;
+    }
+    if (n == 2) {
+      n = 1;
+    }
+    while (n > 0 && depth > contacts.depths[n - 1]) {
+      contacts.points[n] = contacts.points[n - 1];
+      contacts.depths[n] = contacts.depths[n - 1];
+      n--;
+    }
+    contacts.points[n] =
+        vec_add(vertex, vec_multiply(depth / 2, plane_normal));
+    contacts.depths[n] = depth;
+    if (contacts.num_points < 2) {
+      contacts.num_points++;
+    }
+  }
+  contacts.depth = contacts.depths[0];
+  return contacts;
+}
+
+contact_manifold_t find_contacts(body_t *body1, body_t *body2,
+                                 collision_info_t collision) {
+  vector_t normal = collision.axis;
+  contact_manifold_t contacts = {normal, 0, 0, {VEC_ZERO}, {0}};
+  if (!collision.collided) {
+    return contacts;
+  }
+
+  shape_type_t type1 = body_get_shape_type(body1);
+  shape_type_t type2 = body_get_shape_type(body2);
+  polygon_t *poly1 = body_get_collision_polygon(body1);
+  polygon_t *poly2 = body_get_collision_polygon(body2);
+  if (type1 == SHAPE_HALF_PLANE || type2 == SHAPE_HALF_PLANE) {
+    return half_plane_contacts(body1, body2, normal);
+  }
+  if (type1 == SHAPE_POLYGON && type2 == SHAPE_POLYGON) {
+    return polygon_contacts(poly1, poly2, normal);
+  }
+
+  // a circle touches at the point of it furthest along the axis
+  vector_t center1 = body_get_centroid(body1);
+  vector_t center2 = body_get_centroid(body2);
+  double radius1 = body_get_radius(body1);
+  double radius2 = body_get_radius(body2);
+  double max1 = vec_dot(center1, normal) + radius1;
+  double min2 = vec_dot(center2, normal) - radius2;
+  if (type1 == SHAPE_POLYGON) {
+    max1 = get_max_min_projections(poly1, normal).y;
+  }
+  if (type2 == SHAPE_POLYGON) {
+    min2 = get_max_min_projections(poly2, normal).x;
+  }
+
+  contacts.depth = max1 - min2;
+  contacts.num_points = 1;
+  contacts.depths[0] = contacts.depth;
+  if (type1 == SHAPE_CIRCLE) {
+    contacts.points[0] = vec_add(
+        center1, vec_multiply(radius1 - contacts.depth / 2, normal));
+  } else {
+    contacts.points[0] = vec_subtract(
+        center2, vec_multiply(radius2 - contacts.depth / 2, normal));
+  }
+  return contacts;
+}
+
+collision_event_t find_collision_event(body_t *body1, body_t *body2,
+                                       collision_info_t collision) {
+  contact_manifold_t manifold = find_contacts(body1, body2, collision);
+  vector_t relative_velocity =
+      vec_subtract(body_get_velocity(body2), body_get_velocity(body1));
+  return (collision_event_t){body1, body2, collision.axis, manifold.depth,
+                             relative_velocity, NULL, NULL, 0};
+}
+
+/**
+ * Finds when a ray first enters a circle.
+ *
+ * @param start the start of the ray
+ * @param dir the ray, which is followed from time 0 to time 1
+ * @param center the center of the circle
+ * @param radius the radius of the circle
+ * @return the time of the first crossing into the circle, or a negative
+ * number if the ray starts inside the circle or never enters it
+ */
+static double ray_circle_time(vector_t start, vector_t dir, vector_t center,
+                              double radius) {
+  vector_t offset = vec_subtract(start, center);
+  double a = vec_dot(dir, dir);
+  double b = vec_dot(offset, dir);
+  double c = vec_dot(offset, offset) - radius * radius;
+  double discriminant = b * b - a * c;
+  if (c <= 0 || b >= 0 || discriminant < 0) {
+    return -1;
+  }
+  double time = (-b - sqrt(discriminant)) / a;
+  return time <= 1 ? time : -1;
+}
+
+/**
+ * Finds when a circle moving in a straight line first touches a polygon.
+ * This is when its center first enters the polygon grown by the radius,
+ * whose edge are the polygon's edges pushed out by the radius, joined by
+ * circular arcs around the polygon's vertices.
+ *
+ * @param polygon the polygon
+ * @param start the circle's center at time 0
+ * @param motion how far the circle moves by time 1
+ * @param radius the circle's radius
+ * @param time set to the time of first contact, if there is one
+ * @return whether they touch, and if so, the axis from the polygon towards
+ * the circle at first contact (not oriented)
+ */
+static collision_info_t circle_polygon_time(polygon_t *polygon,
+                                            vector_t start, vector_t motion,
+                                            double radius, double *time) {
+  collision_info_t ret = {false, VEC_ZERO};
+  *time = __DBL_MAX__;
+  const vector_t *shape = polygon_get_vertices(polygon);
+  size_t size = polygon_get_num_vertices(polygon);
+  vector_t inside = vertex_average(shape, size);
+
+  for (size_t i = 0; i < size; i++) {
+    vector_t prev = shape[(i + size - 1) % size];
+    vector_t curr = shape[i];
+    vector_t next = shape[(i + 1) % size];
+    vector_t edge = vec_subtract(next, curr);
+    double length = vec_get_length(edge);
+    if (length == 0) {
+      continue;
+    }
+    vector_t normal = outward_normal(shape, size, i, inside);
+
+    // the pushed out edge, only crossed while moving towards the polygon
+    double speed = vec_dot(normal, motion);
+    if (speed < 0) {
+      double gap = vec_dot(normal, vec_subtract(start, curr)) - radius;
+      double edge_time = -gap / speed;
+      vector_t hit = vec_add(start, vec_multiply(edge_time, motion));
+      double along = vec_dot(vec_subtract(hit, curr), edge);
+      if (gap > 0 && edge_time <= 1 && along >= 0 &&
+          along <= length * length && edge_time < *time) {
+        *time = edge_time;
+        ret = (collision_info_t){true, normal};
+      }
+    }
+
+    // the arc around the vertex, which only bounds the grown polygon
+    // between the normals of the edges on either side of it
+    double vertex_time = ray_circle_time(start, motion, curr, radius);
+    if (vertex_time >= 0 && vertex_time < *time) {
+      vector_t hit = vec_add(start, vec_multiply(vertex_time, motion));
+      vector_t axis = vec_multiply(1 / radius, vec_subtract(hit, curr));
+      if (vec_dot(axis, vec_subtract(curr, prev)) >= 0 &&
+          vec_dot(axis, vec_subtract(next, curr)) <= 0) {
+        *time = vertex_time;
+        ret = (collision_info_t){true, axis};
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+ * Finds when two polygons, one moving in a straight line relative to the
+ * other, first touch. On each separating axis the moving polygon's shadow
+ * slides across the other's; they touch once the shadows overlap on every
+ * axis, i.e. at the latest time any axis starts overlapping.
+ *
+ * @param poly1 the moving polygon, at its end position
+ * @param poly2 the other polygon
+ * @param motion how far poly1 moved relative to poly2
+ * @param time set to the time of first contact, if there is one
+ * @return whether they touch, and if so, the axis they touch on
+ * (not oriented)
+ */
+static collision_info_t polygon_polygon_time(polygon_t *poly1,
+                                             polygon_t *poly2,
+                                             vector_t motion, double *time) {
+  collision_info_t ret = {false, VEC_ZERO};
+  double enter = -__DBL_MAX__;
+  double exit = __DBL_MAX__;
+
+  polygon_t *polys[2] = {poly1, poly2};
+  for (size_t p = 0; p < 2; p++) {
+    const vector_t *axes = polygon_get_normals(polys[p]);
+    for (size_t i = 0; i < polygon_get_num_normals(polys[p]); i++) {
+      vector_t shape1_proj = get_max_min_projections(poly1, axes[i]);
+      vector_t shape2_proj = get_max_min_projections(poly2, axes[i]);
+      double speed = vec_dot(motion, axes[i]);
+      // where the first shape's shadow was at the start of the tick
+      double min1 = shape1_proj.x - speed;
+      double max1 = shape1_proj.y - speed;
+
+      if (speed == 0) {
+        if (max1 < shape2_proj.x || shape2_proj.y < min1) {
+          return ret;
+        }
+        continue;
+      }
+
+      double axis_enter = (shape2_proj.x - max1) / speed;
+      double axis_exit = (shape2_proj.y - min1) / speed;
+      if (speed < 0) {
+        double swap = axis_enter;
+        axis_enter = axis_exit;
+        axis_exit = swap;
+      }
+      if (axis_enter > enter) {
+        enter = axis_enter;
+        ret.axis = axes[i];
+      }
+      if (axis_exit < exit) {
+        exit = axis_exit;
+      }
+    }
+  }
+
+  if (enter <= 0 || enter > 1 || enter > exit) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
+  *time = enter;
+  ret.collided = true;
+  return ret;
+}
+
+/**
+ * Finds when a body moving in a straight line relative to a half-plane
+ * first reaches its boundary. Either body may be the half-plane.
+ *
+ * @param motion how far body1 moved relative to body2
+ * @param time set to the time of first contact, if there is one
+ * @return whether they touch, and if so, the half-plane's normal, pointing
+ * from body1 towards body2
+ */
+static collision_info_t half_plane_time(body_t *body1, body_t *body2,
+                                        vector_t motion, double *time) {
+  bool plane_first = body_get_shape_type(body1) == SHAPE_HALF_PLANE;
+  body_t *plane = plane_first ? body1 : body2;
+  body_t *other = plane_first ? body2 : body1;
+  vector_t normal = half_plane_normal(plane);
+  // how far the other body moved out along the normal, and how deep it
+  // was at the start of the tick
+  double speed =
+      vec_dot(normal, plane_first ? vec_negate(motion) : motion);
+  double depth = half_plane_depth(plane, other);
+  double start_depth = depth + speed;
+  if (depth < 0 || start_depth >= 0) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
+  *time = start_depth / speed;
+  return (collision_info_t){true, plane_first ? normal : vec_negate(normal)};
+}
+
+collision_info_t find_time_of_impact(body_t *body1, body_t *body2,
+                                     double *time) {
+  collision_info_t ret = {false, VEC_ZERO};
+  // work in the frame where body2 stays at its end position
+  vector_t motion =
+      vec_subtract(body_get_motion(body1), body_get_motion(body2));
+  if (motion.x == 0 && motion.y == 0) {
+    return ret;
+  }
+
+  shape_type_t type1 = body_get_shape_type(body1);
+  shape_type_t type2 = body_get_shape_type(body2);
+  vector_t center1 = body_get_centroid(body1);
+  vector_t center2 = body_get_centroid(body2);
+  polygon_t *poly1 = body_get_collision_polygon(body1);
+  polygon_t *poly2 = body_get_collision_polygon(body2);
+
+  if (type1 == SHAPE_HALF_PLANE || type2 == SHAPE_HALF_PLANE) {
+    // already oriented, as a half-plane's centroid is just on its boundary
+    return half_plane_time(body1, body2, motion, time);
+  }
+  if (type1 == SHAPE_CIRCLE && type2 == SHAPE_CIRCLE) {
+    vector_t start = vec_subtract(center1, motion);
+    *time = ray_circle_time(start, motion, center2,
+                            body_get_radius(body1) + body_get_radius(body2));
+    if (*time >= 0) {
+      vector_t hit = vec_add(start, vec_multiply(*time, motion));
+      ret = (collision_info_t){true, vec_subtract(hit, center2)};
+      ret.axis = vec_multiply(1 / vec_get_length(ret.axis), ret.axis);
+    }
+  } else if (type1 == SHAPE_CIRCLE) {
+    ret = circle_polygon_time(poly2, vec_subtract(center1, motion), motion,
+                              body_get_radius(body1), time);
+  } else if (type2 == SHAPE_CIRCLE) {
+    // relative to body1, body2 moves the opposite way
+    ret = circle_polygon_time(poly1, vec_add(center2, motion),
+                              vec_negate(motion), body_get_radius(body2),
+                              time);
+  } else {
+    ret = polygon_polygon_time(poly1, poly2, motion, time);
+  }
+
+  if (!ret.collided) {
+    return ret;
+  }
+  // where the centers were when the bodies touched
+  vector_t back = vec_multiply(1 - *time, motion);
+  return orient_collision(ret, center1, vec_add(center2, back));
+}
+
+collision_info_t find_collision_cached(narrowphase_type_t type, body_t *body1,
+                                       body_t *body2, separating_axis_t *cache,
+                                       axis_cache_stats_t *stats) {
+  collision_info_t info = {false, VEC_ZERO};
+  if (!aabb_overlap(body_get_aabb(body1), body_get_aabb(body2))) {
+    return info;
+  }
+
+  if (cache->valid) {
+    vector_t proj1 = project_body(body1, cache->axis);
+    vector_t proj2 = project_body(body2, cache->axis);
+    // separated strictly, as the narrowphases count touching as colliding
+    bool hit = proj1.y < proj2.x || proj2.y < proj1.x;
+    if (stats != NULL) {
+      stats->tests++;
+      stats->hits += hit;
+    }
+    if (hit) {
+      return (collision_info_t){false, cache->axis};
+    }
+  }
+
+  info = find_collision_with(type, body1, body2);
+  cache->valid = !info.collided && (info.axis.x != 0 || info.axis.y != 0);
+  if (cache->valid) {
+    cache->axis = info.axis;
+  }
+  return info;
+}
+
+collision_info_t find_collision_swept(narrowphase_type_t type, body_t *body1,
+                                      body_t *body2, separating_axis_t *cache,
+                                      axis_cache_stats_t *stats) {
+  // most pairs are far apart, so skip the narrowphase if the boxes miss
+  collision_info_t info = {false, VEC_ZERO};
+  if (!aabb_overlap(body_get_aabb(body1), body_get_aabb(body2))) {
+    return info;
+  }
+
+  if (cache != NULL) {
+    info = find_collision_cached(type, body1, body2, cache, stats);
+  } else {
+    info = find_collision_with(type, body1, body2);
+  }
+  // a bullet may have passed through the other body during the tick,
+  // so put both back where they first touched
+  if (!info.collided && (body_is_bullet(body1) || body_is_bullet(body2))) {
+    double time;
+    info = find_time_of_impact(body1, body2, &time);
+    if (info.collided) {
+      body_rewind(body1, time);
+      body_rewind(body2, time);
+    }
+  }
+  return info;
+}
+
+bool point_in_body(body_t *body, vector_t point) {
+  if (!aabb_segment_overlap(body_get_aabb(body), point, point)) {
+    return false;
+  }
+
+  shape_type_t type = body_get_shape_type(body);
+  vector_t offset = vec_subtract(point, body_get_centroid(body));
+  if (type == SHAPE_CIRCLE) {
+    return vec_get_length(offset) <= body_get_radius(body);
+  }
+  if (type == SHAPE_HALF_PLANE) {
+    return vec_dot(half_plane_normal(body), offset) <= 0;
+  }
+
+  // a point outside a convex polygon is past the edge it is outside of,
+  // so it is outside the polygon's shadow on that edge's normal
+  polygon_t *poly = body_get_collision_polygon(body);
+  const vector_t *axes = polygon_get_normals(poly);
+  for (size_t i = 0; i < polygon_get_num_normals(poly); i++) {
+    vector_t proj = get_max_min_projections(poly, axes[i]);
+    double along = vec_dot(axes[i], point);
+    if (along < proj.x || along > proj.y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool find_ray_hit(body_t *body, vector_t start, vector_t end, ray_hit_t *hit) {
+  if (!aabb_segment_overlap(body_get_aabb(body), start, end)) {
+    return false;
+  }
+
+  vector_t dir = vec_subtract(end, start);
+  double fraction;
+  vector_t normal;
+  if (body_get_shape_type(body) == SHAPE_CIRCLE) {
+    vector_t center = body_get_centroid(body);
+    fraction = ray_circle_time(start, dir, center, body_get_radius(body));
+    if (fraction < 0) {
+      return false;
+    }
+    vector_t point = vec_add(start, vec_multiply(fraction, dir));
+    normal = vec_multiply(1 / body_get_radius(body),
+                          vec_subtract(point, center));
+  } else if (body_get_shape_type(body) == SHAPE_HALF_PLANE) {
+    // the segment enters where it crosses the boundary going inwards
+    normal = half_plane_normal(body);
+    vector_t point = body_get_centroid(body);
+    double from = vec_dot(normal, vec_subtract(start, point));
+    double to = vec_dot(normal, vec_subtract(end, point));
+    if (from < 0 || to > 0 || from == to) {
+      return false;
+    }
+    fraction = from / (from - to);
+  } else {
+    // clip the segment to the polygon's shadow on each of its normals; the
+    // shadows only all overlap inside the polygon (or on a segment body)
+    polygon_t *poly = body_get_collision_polygon(body);
+    const vector_t *axes = polygon_get_normals(poly);
+    double enter = -INFINITY;
+    double exit = 1;
+    normal = VEC_ZERO;
+    for (size_t i = 0; i < polygon_get_num_normals(poly); i++) {
+      vector_t proj = get_max_min_projections(poly, axes[i]);
+      double from = vec_dot(axes[i], start);
+      double along = vec_dot(axes[i], dir);
+      if (along == 0) {
+        if (from < proj.x || from > proj.y) {
+          return false;
+        }
+        continue;
+      }
+
+      // the side of the shadow the segment crosses first, then the other
+      double near = along > 0 ? proj.x : proj.y;
+      double far = along > 0 ? proj.y : proj.x;
+      double near_time = (near - from) / along;
+      double far_time = (far - from) / along;
+      if (near_time > enter) {
+        enter = near_time;
+        normal = along > 0 ? vec_negate(axes[i]) : axes[i];
+      }
+      if (far_time < exit) {
+        exit = far_time;
+      }
+    }
+    // a negative entry time means the segment starts inside
+    if (enter < 0 || enter > exit) {
+      return false;
+    }
+    fraction = enter;
+  }
+
+  hit->body = body;
+  hit->fraction = fraction;
+  hit->point = vec_add(start, vec_multiply(fraction, dir));
+  hit->normal = normal;
+  return true;
 }
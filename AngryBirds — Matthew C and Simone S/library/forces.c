@@ -7,6 +7,10 @@
 
 const double MIN_DIST = 5;
 const double HP_SCALAR = 1;
+const double CONTACT_MATCH_DISTANCE = 5;
+const double CONTACT_SLOP = 0.5;
+const double POSITION_CORRECTION = 0.2;
+const size_t CONTACT_ITERATIONS = 10;
 
 typedef struct body_aux {
   double force_const;
@@ -19,6 +23,15 @@ typedef struct collision_aux {
   collision_handler_t handler;
   bool collided;
   void *aux; // aux (if allocated in memory) should be free'd by the caller
+  scene_t *scene; // read for the narrowphase to use each tick
+
+  // the contacts from the last tick and the impulse each one built up,
+  // so a resting contact starts from last tick's answer
+  contact_manifold_t manifold;
+  double impulses[2];
+
+  // the axis that separated the bodies last time they were tested
+  separating_axis_t separating_axis;
 } collision_aux_t;
 
 body_aux_t *body_aux_init(double force_const, list_t *bodies) {
@@ -31,7 +44,8 @@ body_aux_t *body_aux_init(double force_const, list_t *bodies) {
   return aux;
 }
 
-collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
+collision_aux_t *collision_aux_init(scene_t *scene, double force_const,
+                                    list_t *bodies,
                                     collision_handler_t handler, bool collided,
                                     void *aux) {
   collision_aux_t *collision_aux = malloc(sizeof(collision_aux_t));
@@ -42,6 +56,11 @@ collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
   collision_aux->handler = handler;
   collision_aux->collided = collided;
   collision_aux->aux = aux;
+  collision_aux->scene = scene;
+  collision_aux->manifold.num_points = 0;
+  collision_aux->impulses[0] = 0;
+  collision_aux->impulses[1] = 0;
+  collision_aux->separating_axis.valid = false;
   return collision_aux;
 }
 
@@ -193,7 +212,8 @@ void create_drag_list(scene_t *scene, double gamma, list_t *bodies) {
 
 /**
  * The force creator for collisions. Checks if the bodies in the collision aux
- * are colliding, and if they do, runs the collision handler on the bodies.
+ * are colliding, and if they have just started to, queues a collision event
+ * so the scene runs the collision handler on the bodies.
  *
  * @param info auxiliary information about the force and associated body
  */
@@ -206,34 +226,182 @@ static void collision_force_creator(void *collision_aux) {
 
   // Check for collision; if bodies collide, call collision_handler
   bool prev_collision = col_aux->collided;
+  narrowphase_type_t narrowphase = scene_get_narrowphase(col_aux->scene);
+  collision_info_t info =
+      find_collision_swept(narrowphase, body1, body2, &col_aux->separating_axis,
+                           scene_get_axis_cache_stats(col_aux->scene));
 
-  collision_info_t info = find_collision(body1, body2);
   // avoids registering impulse multiple times while bodies are still colliding
   if (info.collided && !prev_collision) {
-    collision_handler_t handler = col_aux->handler;
-    handler(body1, body2, info.axis, col_aux->aux, col_aux->force_const);
+    collision_event_t event = find_collision_event(body1, body2, info);
+    event.handler = col_aux->handler;
+    event.aux = col_aux->aux;
+    event.force_const = col_aux->force_const;
+    scene_add_collision_event(col_aux->scene, event);
     col_aux->collided = true;
   } else if (!info.collided && prev_collision) {
     col_aux->collided = false;
   }
 }
 
+static double inverse_mass(body_t *body) {
+  return body_is_static(body) ? 0 : 1 / body_get_mass(body);
+}
+
+/**
+ * Pushes two overlapping bodies apart along the collision axis, so contacts
+ * that keep pressing together don't slowly sink into each other.
+ * A little overlap is left so the contact stays touching next tick.
+ */
+static void separate_bodies(body_t *body1, body_t *body2,
+                            contact_manifold_t *manifold) {
+  double inv_mass1 = inverse_mass(body1);
+  double inv_mass2 = inverse_mass(body2);
+  double push = POSITION_CORRECTION * fmax(manifold->depth - CONTACT_SLOP, 0) /
+                (inv_mass1 + inv_mass2);
+  vector_t correction = vec_multiply(push, manifold->normal);
+  if (inv_mass1 > 0) {
+    body_set_centroid(body1,
+                      vec_subtract(body_get_centroid(body1),
+                                   vec_multiply(inv_mass1, correction)));
+  }
+  if (inv_mass2 > 0) {
+    body_set_centroid(body2, vec_add(body_get_centroid(body2),
+                                     vec_multiply(inv_mass2, correction)));
+  }
+}
+
+/**
+ * The force creator for physics collisions. Each tick the bodies touch, it
+ * finds their contact points and queues them to be solved with the tick's
+ * other contacts (see solve_contacts()), bouncing on the first tick they
+ * touch. A contact point that is still touching starts from the impulse it
+ * had last tick, so the solver only has to correct it.
+ *
+ * @param collision_aux the collision aux passed to create_physics_collision()
+ */
+static void contact_force_creator(void *collision_aux) {
+  collision_aux_t *col_aux = collision_aux;
+  body_t *body1 = list_get(col_aux->bodies, 0);
+  body_t *body2 = list_get(col_aux->bodies, 1);
+
+  narrowphase_type_t narrowphase = scene_get_narrowphase(col_aux->scene);
+  collision_info_t info =
+      find_collision_swept(narrowphase, body1, body2, &col_aux->separating_axis,
+                           scene_get_axis_cache_stats(col_aux->scene));
+  contact_manifold_t manifold = find_contacts(body1, body2, info);
+  if (manifold.num_points == 0 ||
+      inverse_mass(body1) + inverse_mass(body2) == 0) {
+    col_aux->manifold.num_points = 0;
+    col_aux->collided = false;
+    return;
+  }
+
+  // carry over the impulse of each point that was touching last tick
+  double impulses[2] = {0, 0};
+  for (size_t i = 0; i < manifold.num_points; i++) {
+    for (size_t j = 0; j < col_aux->manifold.num_points; j++) {
+      vector_t offset =
+          vec_subtract(manifold.points[i], col_aux->manifold.points[j]);
+      if (vec_get_length(offset) < CONTACT_MATCH_DISTANCE) {
+        impulses[i] = col_aux->impulses[j];
+        break;
+      }
+    }
+  }
+  col_aux->impulses[0] = impulses[0];
+  col_aux->impulses[1] = impulses[1];
+
+  double restitution = col_aux->collided ? 0 : col_aux->force_const;
+  contact_constraint_t contact = {body1, body2, manifold, restitution,
+                                  col_aux->impulses};
+  scene_add_contact(col_aux->scene, contact);
+  col_aux->manifold = manifold;
+  col_aux->collided = true;
+}
+
+/**
+ * Applies equal and opposite impulses along a contact's normal, pushing its
+ * second body along the normal.
+ */
+static void add_contact_impulse(contact_constraint_t *contact, double mag) {
+  vector_t impulse = vec_multiply(mag, contact->manifold.normal);
+  if (!body_is_static(contact->body1)) {
+    body_add_impulse(contact->body1, vec_negate(impulse));
+  }
+  if (!body_is_static(contact->body2)) {
+    body_add_impulse(contact->body2, impulse);
+  }
+}
+
+/**
+ * Finds how fast a contact's bodies will be moving apart along its normal
+ * after the next tick, from the impulses applied to them so far.
+ */
+static double separating_velocity(contact_constraint_t *contact, double dt) {
+  vector_t velocity1 = body_get_next_velocity(contact->body1, dt);
+  vector_t velocity2 = body_get_next_velocity(contact->body2, dt);
+  return vec_dot(vec_subtract(velocity2, velocity1), contact->manifold.normal);
+}
+
+void solve_contacts(contact_constraint_t *contacts, size_t num_contacts,
+                    double dt) {
+  if (num_contacts == 0) {
+    return;
+  }
+
+  // the bounces are found from how fast the bodies were closing beforehand
+  double targets[num_contacts];
+  for (size_t i = 0; i < num_contacts; i++) {
+    double closing = separating_velocity(&contacts[i], dt);
+    targets[i] = closing < 0 ? -contacts[i].restitution * closing : 0;
+  }
+
+  for (size_t i = 0; i < num_contacts; i++) {
+    contact_constraint_t *contact = &contacts[i];
+    for (size_t j = 0; j < contact->manifold.num_points; j++) {
+      add_contact_impulse(contact, contact->impulses[j]);
+    }
+  }
+
+  // each contact is corrected in turn, so a push one gives is passed along
+  // the rest of a stack over the iterations
+  for (size_t iteration = 0; iteration < CONTACT_ITERATIONS; iteration++) {
+    for (size_t i = 0; i < num_contacts; i++) {
+      contact_constraint_t *contact = &contacts[i];
+      double effective_mass =
+          1 / (inverse_mass(contact->body1) + inverse_mass(contact->body2));
+      for (size_t j = 0; j < contact->manifold.num_points; j++) {
+        double velocity = separating_velocity(contact, dt);
+        // contacts can only push, so the total impulse can't go negative
+        double total = fmax(contact->impulses[j] +
+                                effective_mass * (targets[i] - velocity),
+                            0);
+        add_contact_impulse(contact, total - contact->impulses[j]);
+        contact->impulses[j] = total;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < num_contacts; i++) {
+    separate_bodies(contacts[i].body1, contacts[i].body2,
+                    &contacts[i].manifold);
+  }
+}
+
 void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       double force_const) {
-  list_t *bodies = list_init(2, NULL);
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-
   list_t *aux_bodies = list_init(2, NULL);
   list_add(aux_bodies, body1);
   list_add(aux_bodies, body2);
 
   collision_aux_t *collision_aux =
-      collision_aux_init(force_const, aux_bodies, handler, false, aux);
+      collision_aux_init(scene, force_const, aux_bodies, handler, false, aux);
 
-  scene_add_bodies_force_creator(scene, collision_force_creator, collision_aux,
-                                 bodies);
+  // only checked while the broadphase finds the bodies close to each other
+  scene_add_pair_force_creator(scene, collision_force_creator, collision_aux,
+                               body1, body2);
 }
 
 /**
@@ -280,6 +448,13 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
                               double elasticity) {
-  create_collision(scene, body1, body2, physics_collision_handler, NULL,
-                   elasticity);
+  list_t *aux_bodies = list_init(2, NULL);
+  list_add(aux_bodies, body1);
+  list_add(aux_bodies, body2);
+
+  collision_aux_t *collision_aux =
+      collision_aux_init(scene, elasticity, aux_bodies,
+                         physics_collision_handler, false, NULL);
+  scene_add_pair_force_creator(scene, contact_force_creator, collision_aux,
+                               body1, body2);
 }
@@ -84,3 +84,7 @@ void *list_remove(list_t *list, size_t index) {
     return old_val;
   }
 }
+
+void list_sort(list_t *list, compare_func_t compare) {
+  qsort(list->data, list->size, sizeof(void *), compare);
+}
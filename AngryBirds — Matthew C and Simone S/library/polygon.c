@@ -11,119 +11,591 @@
 
 const double GRAVITY = -9.8;
 const double ROT_ANGLE = 0;
+const double PARALLEL_TOLERANCE = 1e-9;
+const size_t MIN_SIMPLIFIED_POINTS = 3;
+
+/**
+ * The part of a polygon that doesn't change as it moves: its vertices and
+ * normals as they were when it was created, and what follows from them.
+ * Polygons made with polygon_init_instance() share one.
+ */
+typedef struct polygon_shape {
+  // the number of polygons sharing the shape
+  size_t refs;
+  // the vertices relative to the centroid
+  vector_t *local;
+  size_t num_vertices;
+  vector_t *local_normals;
+  size_t num_normals;
+  double area;
+  // the moment of inertia about the centroid of a unit mass
+  double unit_inertia;
+
+  // rectangles are also kept as half-extents along their two normals
+  bool is_box;
+  vector_t half_extents;
+} polygon_shape_t;
 
 typedef struct polygon {
-  list_t *points;
+  shape_type_t type;
+  double radius;
+  polygon_shape_t *shape;
+  // the vertices in the world, in one block rather than a list of pointers
+  vector_t *vertices;
   vector_t vel;
   double rot_speed;
   rgb_color_t *color;
   vector_t center;
   double rot_angle;
+
+  // the pose: the shape is moved to the center and has turned by angle
+  double angle;
+  // whether vertices, xs and ys are behind the pose
+  bool stale;
+
+  vector_t *normals;
+
+  // the vertices again, packed for project_points()
+  double *xs;
+  double *ys;
 } polygon_t;
 
-polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
-                        double rotation_speed, double red, double green,
-                        double blue) {
+/**
+ * Computes the area enclosed by a list of vertices in order.
+ */
+static double vertices_area(const vector_t *vertices, size_t size) {
+  double area = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    vector_t vec_i = vertices[i];
+    vector_t vec_i_plus = vertices[(i + 1) % size];
+
+    area += vec_i.x * vec_i_plus.y;
+
+    area -= vec_i.y * vec_i_plus.x;
+  }
+
+  return fabs(area) * 0.5;
+}
+
+/**
+ * Computes the centroid of the area enclosed by a list of vertices in order.
+ */
+static vector_t vertices_centroid(const vector_t *vertices, size_t size) {
+  double x = 0;
+  double y = 0;
+
+  double area = vertices_area(vertices, size);
+
+  // a segment has no area, so balances at the middle of its vertices
+  if (area == 0) {
+    for (size_t i = 0; i < size; i++) {
+      x += vertices[i].x / size;
+      y += vertices[i].y / size;
+    }
+    return (vector_t){x, y};
+  }
+
+  for (size_t i = 0; i < size; i++) {
+
+    // following the summation formula for a centroid
+
+    vector_t curr = vertices[i];
+    vector_t next = vertices[(i + 1) % size];
+
+    x += (curr.x + next.x) * (vec_cross(curr, next));
+
+    y += (curr.y + next.y) * (vec_cross(curr, next));
+  }
+
+  vector_t center = {x, y};
+
+  return vec_multiply((1 / (6 * area)), center);
+}
+
+/**
+ * Computes the moment of inertia about the centroid of a unit mass spread
+ * evenly over the area enclosed by a list of vertices relative to it.
+ */
+static double vertices_unit_inertia(const vector_t *local, size_t size,
+                                    double area) {
+  // a segment is a thin rod
+  if (area == 0) {
+    double length = vec_get_length(vec_subtract(local[1], local[0]));
+    return length * length / 12;
+  }
+
+  // the sum over the triangles between the centroid and each edge
+  double moment = 0;
+  for (size_t i = 0; i < size; i++) {
+    vector_t curr = local[i];
+    vector_t next = local[(i + 1) % size];
+    moment += vec_cross(curr, next) *
+              (vec_dot(curr, curr) + vec_dot(curr, next) + vec_dot(next, next));
+  }
+  return fabs(moment) / 12 / area;
+}
+
+/**
+ * Computes a shape's unit edge normals, keeping one of each set of
+ * parallel or antiparallel normals, since they project onto the same axis.
+ * The normals are stored as they are at creation, so later rotations can
+ * rotate them from there without accumulating error.
+ */
+static void shape_init_normals(polygon_shape_t *shape,
+                               const vector_t *vertices) {
+  size_t size = shape->num_vertices;
+
+  shape->local_normals = malloc(sizeof(vector_t) * (size + 1));
+  assert(shape->local_normals);
+  shape->num_normals = 0;
+
+  for (size_t i = 0; i < size; i++) {
+    vector_t edge = vec_subtract(vertices[i], vertices[(i + 1) % size]);
+    double length = vec_get_length(edge);
+    if (length == 0) {
+      continue;
+    }
+    vector_t normal = vec_multiply(1 / length, (vector_t){-1 * edge.y, edge.x});
+
+    bool parallel = false;
+    for (size_t j = 0; j < shape->num_normals; j++) {
+      if (fabs(vec_cross(normal, shape->local_normals[j])) <
+          PARALLEL_TOLERANCE) {
+        parallel = true;
+        break;
+      }
+    }
+    if (!parallel) {
+      shape->local_normals[shape->num_normals] = normal;
+      shape->num_normals++;
+    }
+  }
+
+  // a segment's two edges share a normal, so it also needs the axis along
+  // it to tell apart shapes lined up past either of its ends
+  if (size == 2 && shape->num_normals == 1) {
+    vector_t normal = shape->local_normals[0];
+    shape->local_normals[1] = (vector_t){-normal.y, normal.x};
+    shape->num_normals = 2;
+  }
+}
+
+/**
+ * Records whether a shape is a rectangle, and if so its half-extents.
+ * A convex quadrilateral whose edges only have two normals, at right
+ * angles, is a rectangle. Its first normal is its first edge's, and its
+ * extent along that normal is half the length of the second edge.
+ */
+static void shape_init_box(polygon_shape_t *shape, const vector_t *vertices) {
+  shape->is_box = false;
+  shape->half_extents = VEC_ZERO;
+  if (shape->num_vertices != 4 || shape->num_normals != 2 ||
+      fabs(vec_dot(shape->local_normals[0], shape->local_normals[1])) >=
+          PARALLEL_TOLERANCE) {
+    return;
+  }
+
+  double first = vec_get_length(vec_subtract(vertices[1], vertices[0]));
+  double second = vec_get_length(vec_subtract(vertices[2], vertices[1]));
+  shape->is_box = true;
+  shape->half_extents = (vector_t){second / 2, first / 2};
+}
+
+/**
+ * Allocates a shape for a polygon created with the given vertices, and
+ * computes everything about it that doesn't change as it moves.
+ *
+ * @param vertices the vertices in the world
+ * @param size the number of vertices, 0 for a circle or half-plane
+ * @param center the centroid of the vertices, which they are kept relative to
+ */
+static polygon_shape_t *shape_init(const vector_t *vertices, size_t size,
+                                   vector_t center) {
+  polygon_shape_t *shape = malloc(sizeof(polygon_shape_t));
+  assert(shape);
+  shape->refs = 1;
+  shape->num_vertices = size;
+
+  // malloc(0) may return NULL, so always ask for at least one
+  shape->local = malloc(sizeof(vector_t) * (size + 1));
+  assert(shape->local);
+  for (size_t i = 0; i < size; i++) {
+    shape->local[i] = vec_subtract(vertices[i], center);
+  }
+  shape_init_normals(shape, vertices);
+  shape_init_box(shape, vertices);
+  shape->area = 0;
+  shape->unit_inertia = 0;
+  if (size > 0) {
+    shape->area = vertices_area(shape->local, size);
+    shape->unit_inertia =
+        vertices_unit_inertia(shape->local, size, shape->area);
+  }
+  return shape;
+}
+
+/**
+ * Lets go of a polygon's reference to a shape, freeing it if it was the last.
+ */
+static void shape_release(polygon_shape_t *shape) {
+  shape->refs--;
+  if (shape->refs == 0) {
+    free(shape->local);
+    free(shape->local_normals);
+    free(shape);
+  }
+}
+
+/**
+ * Allocates a polygon of a given shape, unrotated, with its centroid at a
+ * given point. The polygon takes over the caller's reference to the shape.
+ *
+ * @param vertices the vertices in the world, if already known, which the
+ * polygon takes ownership of; otherwise NULL to find them from the pose
+ */
+static polygon_t *polygon_init_with_shape(shape_type_t type, double radius,
+                                          polygon_shape_t *shape,
+                                          vector_t center, vector_t *vertices,
+                                          vector_t initial_velocity,
+                                          double rotation_speed, double red,
+                                          double green, double blue) {
   polygon_t *polygon = malloc(sizeof(polygon_t));
   assert(polygon);
 
-  polygon->points = points;
+  size_t size = shape->num_vertices;
+  polygon->type = type;
+  polygon->radius = radius;
+  polygon->shape = shape;
+  polygon->vertices = vertices;
+  if (vertices == NULL) {
+    polygon->vertices = malloc(sizeof(vector_t) * (size + 1));
+    assert(polygon->vertices);
+  }
   polygon->vel = initial_velocity;
   polygon->rot_speed = rotation_speed;
   polygon->color = color_init(red, green, blue);
+  polygon->center = center;
   polygon->rot_angle = ROT_ANGLE;
-  polygon->center = polygon_centroid(polygon);
+  polygon->angle = 0;
+  polygon->stale = vertices == NULL;
+
+  polygon->normals = malloc(sizeof(vector_t) * (shape->num_normals + 1));
+  assert(polygon->normals);
+  for (size_t i = 0; i < shape->num_normals; i++) {
+    polygon->normals[i] = shape->local_normals[i];
+  }
+
+  polygon->xs = malloc(sizeof(double) * (size + 1));
+  polygon->ys = malloc(sizeof(double) * (size + 1));
+  assert(polygon->xs);
+  assert(polygon->ys);
+  if (vertices != NULL) {
+    for (size_t i = 0; i < size; i++) {
+      polygon->xs[i] = vertices[i].x;
+      polygon->ys[i] = vertices[i].y;
+    }
+  }
 
   return polygon;
 }
 
-list_t *polygon_get_points(polygon_t *polygon) { return polygon->points; }
+polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
+                        double rotation_speed, double red, double green,
+                        double blue) {
+  // the vertices are copied into one block, which the polygon keeps
+  size_t size = list_size(points);
+  vector_t *vertices = malloc(sizeof(vector_t) * (size + 1));
+  assert(vertices);
+  for (size_t i = 0; i < size; i++) {
+    vertices[i] = *(vector_t *)list_get(points, i);
+  }
+  list_free(points);
 
-void polygon_move(polygon_t *polygon, double time_elapsed) {
+  vector_t center = vertices_centroid(vertices, size);
+  polygon_shape_t *shape = shape_init(vertices, size, center);
+  return polygon_init_with_shape(SHAPE_POLYGON, 0, shape, center, vertices,
+                                 initial_velocity, rotation_speed, red, green,
+                                 blue);
+}
 
-  polygon_translate(polygon, vec_multiply(time_elapsed, polygon->vel));
+polygon_t *polygon_init_circle(vector_t center, double radius,
+                               vector_t initial_velocity, double rotation_speed,
+                               double red, double green, double blue) {
+  assert(radius > 0);
+
+  polygon_shape_t *shape = shape_init(NULL, 0, center);
+  shape->area = M_PI * radius * radius;
+  shape->unit_inertia = radius * radius / 2;
+  return polygon_init_with_shape(SHAPE_CIRCLE, radius, shape, center, NULL,
+                                 initial_velocity, rotation_speed, red, green,
+                                 blue);
+}
 
-  polygon_rotate(polygon, time_elapsed * polygon->rot_speed,
-                 polygon_centroid(polygon));
+polygon_t *polygon_init_half_plane(vector_t point, vector_t normal,
+                                   vector_t initial_velocity,
+                                   double rotation_speed, double red,
+                                   double green, double blue) {
+  double length = vec_get_length(normal);
+  assert(length > 0);
+
+  polygon_shape_t *shape = shape_init(NULL, 0, point);
+  // the boundary's normal is the one normal, rotated like an edge's
+  shape->local_normals[0] = vec_multiply(1 / length, normal);
+  shape->num_normals = 1;
+  shape->area = INFINITY;
+  shape->unit_inertia = INFINITY;
+  return polygon_init_with_shape(SHAPE_HALF_PLANE, 0, shape, point, NULL,
+                                 initial_velocity, rotation_speed, red, green,
+                                 blue);
 }
 
-void polygon_set_velocity(polygon_t *polygon, vector_t velocity) {
-  polygon->vel.x = velocity.x;
-  polygon->vel.y = velocity.y;
+polygon_t *polygon_init_instance(polygon_t *prototype, vector_t center,
+                                 vector_t initial_velocity,
+                                 double rotation_speed, double red,
+                                 double green, double blue) {
+  prototype->shape->refs++;
+  return polygon_init_with_shape(prototype->type, prototype->radius,
+                                 prototype->shape, center, NULL,
+                                 initial_velocity, rotation_speed, red, green,
+                                 blue);
 }
 
-void polygon_free(polygon_t *polygon) {
-  list_free(polygon->points);
-  color_free(polygon->color);
-  free(polygon);
+/**
+ * Measures how far a polygon's boundary strays from the chord between two of
+ * its vertices: the furthest any vertex strictly between them is from it.
+ */
+static double chord_error(const vector_t *vertices, size_t size, size_t from,
+                          size_t to) {
+  vector_t start = vertices[from];
+  vector_t chord = vec_subtract(vertices[to], start);
+  double length = vec_get_length(chord);
+  double error = 0;
+
+  for (size_t i = (from + 1) % size; i != to; i = (i + 1) % size) {
+    vector_t offset = vec_subtract(vertices[i], start);
+    double distance = length == 0 ? vec_get_length(offset)
+                                  : fabs(vec_cross(chord, offset)) / length;
+    error = fmax(error, distance);
+  }
+  return error;
 }
 
-double polygon_get_velocity_x(polygon_t *polygon) { return polygon->vel.x; }
+/**
+ * Gets the index of the next kept vertex after i, going around the polygon.
+ */
+static size_t next_kept(const bool *kept, size_t size, size_t i) {
+  do {
+    i = (i + 1) % size;
+  } while (!kept[i]);
+  return i;
+}
 
-double polygon_get_velocity_y(polygon_t *polygon) { return polygon->vel.y; }
+/**
+ * Gets the index of the previous kept vertex before i.
+ */
+static size_t prev_kept(const bool *kept, size_t size, size_t i) {
+  do {
+    i = (i + size - 1) % size;
+  } while (!kept[i]);
+  return i;
+}
 
-vector_t *polygon_get_velocity(polygon_t *polygon) { return &polygon->vel; }
+polygon_t *polygon_simplify(polygon_t *polygon, double tolerance) {
+  if (polygon->type != SHAPE_POLYGON) {
+    return NULL;
+  }
 
-double polygon_area(polygon_t *polygon) {
-  double area = 0;
+  const vector_t *vertices = polygon_get_vertices(polygon);
+  size_t size = polygon->shape->num_vertices;
+  rgb_color_t *color = polygon->color;
 
-  for (size_t i = 0; i < list_size(polygon_get_points(polygon)); i++) {
-    vector_t vec_i = *(vector_t *)list_get(polygon_get_points(polygon), i);
-    vector_t vec_i_plus =
-        *(vector_t *)list_get(polygon_get_points(polygon),
-                              (i + 1) % list_size(polygon_get_points(polygon)));
+  // the boundary lies between its nearest edge and its furthest vertex,
+  // so a circle halfway between them is within half that gap everywhere
+  vector_t center = polygon_centroid(polygon);
+  double outer = 0;
+  double inner = __DBL_MAX__;
+  for (size_t i = 0; i < size; i++) {
+    vector_t curr = vertices[i];
+    vector_t edge = vec_subtract(vertices[(i + 1) % size], curr);
+    double length = vec_get_length(edge);
+    outer = fmax(outer, vec_get_length(vec_subtract(curr, center)));
+    if (length > 0) {
+      double distance =
+          fabs(vec_cross(edge, vec_subtract(center, curr))) / length;
+      inner = fmin(inner, distance);
+    }
+  }
+  if (inner <= outer && (outer - inner) / 2 <= tolerance) {
+    return polygon_init_circle(center, (outer + inner) / 2, polygon->vel,
+                               polygon->rot_speed, color->r, color->g,
+                               color->b);
+  }
 
-    area += vec_i.x * vec_i_plus.y;
+  // otherwise drop whichever vertex strays least, while that is close enough.
+  // The kept vertices are a subset of a convex polygon's, so stay convex.
+  bool *kept = malloc(sizeof(bool) * (size + 1));
+  assert(kept);
+  for (size_t i = 0; i < size; i++) {
+    kept[i] = true;
+  }
+  size_t num_kept = size;
+  while (num_kept > MIN_SIMPLIFIED_POINTS) {
+    size_t best = size;
+    double best_error = tolerance;
+    for (size_t i = 0; i < size; i++) {
+      if (!kept[i]) {
+        continue;
+      }
+      double error = chord_error(vertices, size, prev_kept(kept, size, i),
+                                 next_kept(kept, size, i));
+      if (error <= best_error) {
+        best = i;
+        best_error = error;
+      }
+    }
+    if (best == size) {
+      break;
+    }
+    kept[best] = false;
+    num_kept--;
+  }
 
-    area -= vec_i.y * vec_i_plus.x;
+  if (num_kept == size) {
+    free(kept);
+    return NULL;
   }
 
-  return fabs(area) * 0.5;
+  list_t *simple = list_init(num_kept, free);
+  for (size_t i = 0; i < size; i++) {
+    if (kept[i]) {
+      vector_t *point = malloc(sizeof(vector_t));
+      assert(point);
+      *point = vertices[i];
+      list_add(simple, point);
+    }
+  }
+  free(kept);
+  return polygon_init(simple, polygon->vel, polygon->rot_speed, color->r,
+                      color->g, color->b);
 }
 
-vector_t polygon_centroid(polygon_t *polygon) {
-  double x = 0;
-  double y = 0;
+shape_type_t polygon_get_type(polygon_t *polygon) { return polygon->type; }
 
-  size_t size = list_size(polygon_get_points(polygon));
+double polygon_get_radius(polygon_t *polygon) { return polygon->radius; }
 
-  for (size_t i = 0; i < size; i++) {
+void polygon_update_vertices(polygon_t *polygon) {
+  if (!polygon->stale) {
+    return;
+  }
 
-    // following the summation formula for a centroid
+  // every vertex turns by the same angle, so find its cosine and sine once
+  double cos_angle = cos(polygon->angle);
+  double sin_angle = sin(polygon->angle);
+  vector_t center = polygon->center;
+  for (size_t i = 0; i < polygon->shape->num_vertices; i++) {
+    vector_t local = polygon->shape->local[i];
+    vector_t *vertex = &polygon->vertices[i];
+    vertex->x = center.x + (local.x * cos_angle - local.y * sin_angle);
+    vertex->y = center.y + (local.x * sin_angle + local.y * cos_angle);
+    polygon->xs[i] = vertex->x;
+    polygon->ys[i] = vertex->y;
+  }
+  polygon->stale = false;
+}
 
-    vector_t *curr = list_get(polygon_get_points(polygon), i);
-    vector_t *next = list_get(polygon_get_points(polygon), (i + 1) % size);
+const vector_t *polygon_get_vertices(polygon_t *polygon) {
+  polygon_update_vertices(polygon);
+  return polygon->vertices;
+}
 
-    x += (curr->x + next->x) * (vec_cross(*curr, *next));
+size_t polygon_get_num_vertices(polygon_t *polygon) {
+  return polygon->shape->num_vertices;
+}
 
-    y += (curr->y + next->y) * (vec_cross(*curr, *next));
-  }
+size_t polygon_get_num_normals(polygon_t *polygon) {
+  return polygon->shape->num_normals;
+}
 
-  vector_t center = {x, y};
+bool polygon_is_box(polygon_t *polygon) { return polygon->shape->is_box; }
 
-  return vec_multiply((1 / (6 * polygon_area(polygon))), center);
+vector_t polygon_get_half_extents(polygon_t *polygon) {
+  return polygon->shape->half_extents;
 }
 
-void polygon_translate(polygon_t *polygon, vector_t translation) {
-  for (size_t i = 0; i < list_size(polygon_get_points(polygon)); i++) {
-    *(vector_t *)list_get(polygon_get_points(polygon), i) = vec_add(
-        *(vector_t *)list_get(polygon_get_points(polygon), i), translation);
-  }
+const vector_t *polygon_get_normals(polygon_t *polygon) {
+  return polygon->normals;
 }
 
-void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
-  for (size_t i = 0; i < list_size(polygon_get_points(polygon)); i++) {
-    vector_t vec_i = *(vector_t *)list_get(polygon_get_points(polygon), i);
+const double *polygon_get_xs(polygon_t *polygon) {
+  polygon_update_vertices(polygon);
+  return polygon->xs;
+}
+
+const double *polygon_get_ys(polygon_t *polygon) {
+  polygon_update_vertices(polygon);
+  return polygon->ys;
+}
+
+void polygon_move(polygon_t *polygon, double time_elapsed) {
+
+  polygon_translate(polygon, vec_multiply(time_elapsed, polygon->vel));
+
+  polygon_rotate(polygon, time_elapsed * polygon->rot_speed,
+                 polygon_centroid(polygon));
+}
+
+void polygon_set_velocity(polygon_t *polygon, vector_t velocity) {
+  polygon->vel.x = velocity.x;
+  polygon->vel.y = velocity.y;
+}
+
+void polygon_free(polygon_t *polygon) {
+  free(polygon->vertices);
+  shape_release(polygon->shape);
+  free(polygon->normals);
+  free(polygon->xs);
+  free(polygon->ys);
+  color_free(polygon->color);
+  free(polygon);
+}
 
-    // subtract to shift origin to point being rotated about
-    // rotate using the rotation matrix
-    // add to bring the origin back to the original position
+double polygon_get_velocity_x(polygon_t *polygon) { return polygon->vel.x; }
 
-    vector_t to_origin = vec_subtract(vec_i, point);
-    vector_t rotate = vec_rotate(to_origin, angle);
-    vector_t ret = vec_add(rotate, point);
-    *(vector_t *)list_get(polygon_get_points(polygon), i) = ret;
+double polygon_get_velocity_y(polygon_t *polygon) { return polygon->vel.y; }
+
+vector_t *polygon_get_velocity(polygon_t *polygon) { return &polygon->vel; }
+
+double polygon_area(polygon_t *polygon) { return polygon->shape->area; }
+
+vector_t polygon_centroid(polygon_t *polygon) { return polygon->center; }
+
+double polygon_moment_of_inertia(polygon_t *polygon, double mass) {
+  return mass * polygon->shape->unit_inertia;
+}
+
+void polygon_translate(polygon_t *polygon, vector_t translation) {
+  polygon->center = vec_add(polygon->center, translation);
+  polygon->stale = true;
+}
+
+void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
+  // subtract to shift origin to point being rotated about
+  // rotate using the rotation matrix
+  // add to bring the origin back to the original position
+  polygon->center =
+      vec_add(vec_rotate(vec_subtract(polygon->center, point), angle), point);
+
+  // the vertices and normals don't depend on the point rotated about,
+  // only the total angle
+  if (angle != 0) {
+    polygon->angle += angle;
+    polygon_shape_t *shape = polygon->shape;
+    for (size_t i = 0; i < shape->num_normals; i++) {
+      polygon->normals[i] = vec_rotate(shape->local_normals[i], polygon->angle);
+    }
   }
+  polygon->stale = true;
 }
 
 rgb_color_t *polygon_get_color(polygon_t *polygon) { return polygon->color; }
@@ -135,10 +607,8 @@ void polygon_set_color(polygon_t *polygon, rgb_color_t *color) {
 }
 
 void polygon_set_center(polygon_t *polygon, vector_t centroid) {
-  vector_t old_centroid = polygon_centroid(polygon);
-  vector_t translate = vec_subtract(centroid, old_centroid);
-  polygon_translate(polygon, translate);
   polygon->center = centroid;
+  polygon->stale = true;
 }
 
 vector_t polygon_get_center(polygon_t *polygon) { return polygon->center; }
@@ -0,0 +1,160 @@
+#include "projection.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PROJECTION_SIMD
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PROJECTION_SIMD
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define PROJECTION_SIMD
+#endif
+
+// every kernel must round x * axis.x + y * axis.y the same way, so don't let
+// the compiler fuse the multiplies and adds where it has FMA instructions
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+vector_t project_points_scalar(const double *xs, const double *ys,
+                               size_t num_points, vector_t axis) {
+  double min = __DBL_MAX__;
+  double max = -min;
+
+  for (size_t i = 0; i < num_points; i++) {
+    double dot = xs[i] * axis.x + ys[i] * axis.y;
+
+    if (dot < min) {
+      min = dot;
+    }
+
+    if (dot > max) {
+      max = dot;
+    }
+  }
+
+  return (vector_t){min, max};
+}
+
+#ifdef PROJECTION_SIMD
+/**
+ * Combines the (min, max) of a block of lanes with the (min, max) of the
+ * points left over after them.
+ */
+static vector_t merge_lanes(const double *mins, const double *maxs,
+                            size_t num_lanes, vector_t rest) {
+  for (size_t i = 0; i < num_lanes; i++) {
+    if (mins[i] < rest.x) {
+      rest.x = mins[i];
+    }
+    if (maxs[i] > rest.y) {
+      rest.y = maxs[i];
+    }
+  }
+  return rest;
+}
+#endif
+
+#if defined(__AVX__)
+
+const size_t PROJECTION_LANES = 4;
+
+vector_t project_points(const double *xs, const double *ys, size_t num_points,
+                        vector_t axis) {
+  __m256d axis_x = _mm256_set1_pd(axis.x);
+  __m256d axis_y = _mm256_set1_pd(axis.y);
+  __m256d min = _mm256_set1_pd(__DBL_MAX__);
+  __m256d max = _mm256_set1_pd(-__DBL_MAX__);
+
+  size_t i = 0;
+  for (; i + PROJECTION_LANES <= num_points; i += PROJECTION_LANES) {
+    __m256d dot = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(xs + i), axis_x),
+                                _mm256_mul_pd(_mm256_loadu_pd(ys + i), axis_y));
+    min = _mm256_min_pd(min, dot);
+    max = _mm256_max_pd(max, dot);
+  }
+
+  double mins[4];
+  double maxs[4];
+  _mm256_storeu_pd(mins, min);
+  _mm256_storeu_pd(maxs, max);
+  return merge_lanes(
+      mins, maxs, PROJECTION_LANES,
+      project_points_scalar(xs + i, ys + i, num_points - i, axis));
+}
+
+const char *project_points_kernel(void) { return "avx"; }
+
+#elif defined(__SSE2__)
+
+const size_t PROJECTION_LANES = 2;
+
+vector_t project_points(const double *xs, const double *ys, size_t num_points,
+                        vector_t axis) {
+  __m128d axis_x = _mm_set1_pd(axis.x);
+  __m128d axis_y = _mm_set1_pd(axis.y);
+  __m128d min = _mm_set1_pd(__DBL_MAX__);
+  __m128d max = _mm_set1_pd(-__DBL_MAX__);
+
+  size_t i = 0;
+  for (; i + PROJECTION_LANES <= num_points; i += PROJECTION_LANES) {
+    __m128d dot = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(xs + i), axis_x),
+                             _mm_mul_pd(_mm_loadu_pd(ys + i), axis_y));
+    min = _mm_min_pd(min, dot);
+    max = _mm_max_pd(max, dot);
+  }
+
+  double mins[2];
+  double maxs[2];
+  _mm_storeu_pd(mins, min);
+  _mm_storeu_pd(maxs, max);
+  return merge_lanes(
+      mins, maxs, PROJECTION_LANES,
+      project_points_scalar(xs + i, ys + i, num_points - i, axis));
+}
+
+const char *project_points_kernel(void) { return "sse2"; }
+
+#elif defined(__wasm_simd128__)
+
+const size_t PROJECTION_LANES = 2;
+
+vector_t project_points(const double *xs, const double *ys, size_t num_points,
+                        vector_t axis) {
+  v128_t axis_x = wasm_f64x2_splat(axis.x);
+  v128_t axis_y = wasm_f64x2_splat(axis.y);
+  v128_t min = wasm_f64x2_splat(__DBL_MAX__);
+  v128_t max = wasm_f64x2_splat(-__DBL_MAX__);
+
+  size_t i = 0;
+  for (; i + PROJECTION_LANES <= num_points; i += PROJECTION_LANES) {
+    v128_t dot = wasm_f64x2_add(wasm_f64x2_mul(wasm_v128_load(xs + i), axis_x),
+                                wasm_f64x2_mul(wasm_v128_load(ys + i), axis_y));
+    min = wasm_f64x2_pmin(min, dot);
+    max = wasm_f64x2_pmax(max, dot);
+  }
+
+  double mins[2] = {wasm_f64x2_extract_lane(min, 0),
+                    wasm_f64x2_extract_lane(min, 1)};
+  double maxs[2] = {wasm_f64x2_extract_lane(max, 0),
+                    wasm_f64x2_extract_lane(max, 1)};
+  return merge_lanes(
+      mins, maxs, PROJECTION_LANES,
+      project_points_scalar(xs + i, ys + i, num_points - i, axis));
+}
+
+const char *project_points_kernel(void) { return "wasm_simd"; }
+
+#else
+
+vector_t project_points(const double *xs, const double *ys, size_t num_points,
+                        vector_t axis) {
+  return project_points_scalar(xs, ys, num_points, axis);
+}
+
+const char *project_points_kernel(void) { return "scalar"; }
+
+#endif
@@ -1,12 +1,51 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "body.h"
+#include "broadphase.h"
 #include "forces.h"
 #include "list.h"
 #include "scene.h"
+#include "thread_pool.h"
+
+/**
+ * A force creator registered on a pair of bodies.
+ * The bodies are stored in address order so both orders of the same pair
+ * share a key.
+ */
+typedef struct pair_force_creator {
+  body_t *key1;
+  body_t *key2;
+  force_creator_t forcer;
+  void *aux;
+  size_t order;
+  size_t last_tick;
+} pair_force_creator_t;
+
+/**
+ * The collision handler registered on a pair of layers.
+ * Every handler is stored under both orders of its layers; swapped is set on
+ * the copy whose layers are the other way around from the registration, so
+ * the handler still gets its bodies in the order it expects.
+ */
+typedef struct layer_handler {
+  collision_handler_t handler;
+  void *aux;
+  double force_const;
+  bool swapped;
+} layer_handler_t;
+
+/**
+ * The narrowphase result for one pair found by the broadphase.
+ * entry is NULL if the pair has no layer handler, or can't collide.
+ */
+typedef struct layer_collision {
+  layer_handler_t *entry;
+  collision_info_t info;
+} layer_collision_t;
 
 struct scene {
   size_t num_bodies;
@@ -14,13 +53,63 @@ struct scene {
   list_t *force_creators;
   list_t *auxs;
   list_t *force_bodies;
+
+  broadphase_t *broadphase;
+  list_t *pair_creators;
+  size_t num_sorted_pairs;
+  size_t num_pairs_added;
+  list_t *touching_pairs;
+  list_t *prev_touching_pairs;
+  size_t tick;
+
+  narrowphase_type_t narrowphase;
+  axis_cache_stats_t axis_cache_stats;
+
+  layer_handler_t *layer_handlers;
+  list_t *layer_contacts;
+  list_t *prev_layer_contacts;
+
+  thread_pool_t *pool;
+  layer_collision_t *layer_collisions;
+  // the pairs passed to find_collisions_batch(), and its results
+  pair_t *narrowphase_pairs;
+  collision_info_t *narrowphase_infos;
+  size_t layer_collisions_capacity;
+  list_t *rewound_bodies;
+
+  bool broadphase_stale;
+  bool finding_pairs;
+  list_t *query_results;
+
+  collision_event_t *events;
+  // scratch space for dispatching the events grouped by handler
+  size_t *event_groups;
+  size_t *event_order;
+  size_t *group_starts;
+  size_t *handler_slots;
+  size_t num_handler_slots;
+  size_t num_events;
+  size_t event_capacity;
+  bool dispatching;
+
+  contact_constraint_t *contacts;
+  size_t num_contacts;
+  size_t contact_capacity;
 };
 
 const size_t SCENE_CAPACITY = 15;
+const double BROADPHASE_CELL_SIZE = 100;
+const size_t MIN_HANDLER_SLOTS = 16;
+const size_t HANDLER_HASH_PRIME = 2654435761;
+const size_t EMPTY_HANDLER_SLOT = SIZE_MAX;
 
 force_creator_t force_creator_scene = NULL;
 
 scene_t *scene_init(void) {
+  return scene_init_with_broadphase(BROADPHASE_GRID);
+}
+
+scene_t *scene_init_with_broadphase(broadphase_type_t type) {
   scene_t *scene = malloc(sizeof(scene_t));
   assert(scene);
 
@@ -35,14 +124,123 @@ scene_t *scene_init(void) {
   scene->force_bodies = force_bodies;
   scene->num_bodies = 0;
 
+  if (type == BROADPHASE_SWEEP_AND_PRUNE) {
+    scene->broadphase = broadphase_init_sweep_and_prune();
+  } else if (type == BROADPHASE_TREE) {
+    scene->broadphase = broadphase_init_tree();
+  } else {
+    scene->broadphase = broadphase_init(BROADPHASE_CELL_SIZE);
+  }
+  scene->pair_creators = list_init(SCENE_CAPACITY, NULL);
+  scene->num_sorted_pairs = 0;
+  scene->num_pairs_added = 0;
+  scene->touching_pairs = list_init(SCENE_CAPACITY, NULL);
+  scene->prev_touching_pairs = list_init(SCENE_CAPACITY, NULL);
+  scene->tick = 0;
+  scene->narrowphase = NARROWPHASE_SAT;
+  scene->axis_cache_stats = (axis_cache_stats_t){0, 0};
+
+  scene->layer_handlers =
+      malloc(NUM_COLLISION_LAYERS * NUM_COLLISION_LAYERS *
+             sizeof(layer_handler_t));
+  assert(scene->layer_handlers);
+  for (size_t i = 0; i < NUM_COLLISION_LAYERS * NUM_COLLISION_LAYERS; i++) {
+    scene->layer_handlers[i] = (layer_handler_t){NULL, NULL, 0, false};
+  }
+  scene->layer_contacts = list_init(SCENE_CAPACITY, free);
+  scene->prev_layer_contacts = list_init(SCENE_CAPACITY, free);
+
+  scene->pool = thread_pool_init(1);
+  scene->layer_collisions = NULL;
+  scene->narrowphase_pairs = NULL;
+  scene->narrowphase_infos = NULL;
+  scene->layer_collisions_capacity = 0;
+  scene->rewound_bodies = list_init(SCENE_CAPACITY, NULL);
+  scene->broadphase_stale = false;
+  scene->finding_pairs = false;
+  scene->query_results = list_init(SCENE_CAPACITY, NULL);
+  scene->events = NULL;
+  scene->event_groups = NULL;
+  scene->event_order = NULL;
+  scene->group_starts = NULL;
+  scene->handler_slots = NULL;
+  scene->num_handler_slots = 0;
+  scene->num_events = 0;
+  scene->event_capacity = 0;
+  scene->dispatching = false;
+  scene->contacts = NULL;
+  scene->num_contacts = 0;
+  scene->contact_capacity = 0;
+
   return scene;
 }
 
+void scene_set_narrowphase(scene_t *scene, narrowphase_type_t type) {
+  scene->narrowphase = type;
+}
+
+narrowphase_type_t scene_get_narrowphase(scene_t *scene) {
+  return scene->narrowphase;
+}
+
+axis_cache_stats_t *scene_get_axis_cache_stats(scene_t *scene) {
+  return &scene->axis_cache_stats;
+}
+
+void scene_set_num_threads(scene_t *scene, size_t num_threads) {
+  thread_pool_free(scene->pool);
+  scene->pool = thread_pool_init(num_threads);
+}
+
+size_t scene_get_num_threads(scene_t *scene) {
+  return thread_pool_num_threads(scene->pool);
+}
+
+void scene_set_layer_handler(scene_t *scene, size_t layer1, size_t layer2,
+                             collision_handler_t handler, void *aux,
+                             double force_const) {
+  assert(layer1 < NUM_COLLISION_LAYERS && layer2 < NUM_COLLISION_LAYERS);
+  scene->layer_handlers[layer1 * NUM_COLLISION_LAYERS + layer2] =
+      (layer_handler_t){handler, aux, force_const, false};
+  if (layer1 != layer2) {
+    scene->layer_handlers[layer2 * NUM_COLLISION_LAYERS + layer1] =
+        (layer_handler_t){handler, aux, force_const, true};
+  }
+}
+
+static void pair_force_creator_free(pair_force_creator_t *pair) {
+  body_aux_free(pair->aux);
+  free(pair);
+}
+
 void scene_free(scene_t *scene) {
   list_free(scene->bodies);
   list_free(scene->force_creators);
   list_free(scene->auxs);
   list_free(scene->force_bodies);
+
+  for (size_t i = 0; i < list_size(scene->pair_creators); i++) {
+    pair_force_creator_free(list_get(scene->pair_creators, i));
+  }
+  list_free(scene->pair_creators);
+  list_free(scene->touching_pairs);
+  list_free(scene->prev_touching_pairs);
+  free(scene->layer_handlers);
+  list_free(scene->layer_contacts);
+  list_free(scene->prev_layer_contacts);
+  thread_pool_free(scene->pool);
+  free(scene->layer_collisions);
+  free(scene->narrowphase_pairs);
+  free(scene->narrowphase_infos);
+  list_free(scene->rewound_bodies);
+  list_free(scene->query_results);
+  free(scene->events);
+  free(scene->event_groups);
+  free(scene->event_order);
+  free(scene->group_starts);
+  free(scene->handler_slots);
+  free(scene->contacts);
+  broadphase_free(scene->broadphase);
   free(scene);
 }
 
@@ -55,6 +253,7 @@ body_t *scene_get_body(scene_t *scene, size_t index) {
 void scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
   scene->num_bodies++;
+  scene->broadphase_stale = true;
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
@@ -76,7 +275,485 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
   list_add(scene->force_creators, forcer);
 }
 
+/**
+ * Orders two body pointers by address, so a pair has the same key
+ * regardless of the order its bodies are given in.
+ */
+static int compare_keys(body_t *a1, body_t *a2, body_t *b1, body_t *b2) {
+  if (a1 != b1) {
+    return (uintptr_t)a1 < (uintptr_t)b1 ? -1 : 1;
+  }
+  if (a2 != b2) {
+    return (uintptr_t)a2 < (uintptr_t)b2 ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Returns a pair with its bodies in address order, i.e. the pair's key.
+ */
+static pair_t pair_key(body_t *body1, body_t *body2) {
+  if ((uintptr_t)body1 < (uintptr_t)body2) {
+    return (pair_t){body1, body2};
+  }
+  return (pair_t){body2, body1};
+}
+
+static int compare_pair_force_creators(const void *p1, const void *p2) {
+  pair_force_creator_t *pair1 = *(pair_force_creator_t **)p1;
+  pair_force_creator_t *pair2 = *(pair_force_creator_t **)p2;
+  int key_order =
+      compare_keys(pair1->key1, pair1->key2, pair2->key1, pair2->key2);
+  if (key_order != 0) {
+    return key_order;
+  }
+  // keep force creators on the same pair in the order they were added
+  return pair1->order < pair2->order ? -1 : 1;
+}
+
+void scene_add_pair_force_creator(scene_t *scene, force_creator_t forcer,
+                                  void *aux, body_t *body1, body_t *body2) {
+  pair_force_creator_t *pair = malloc(sizeof(pair_force_creator_t));
+  assert(pair);
+
+  pair_t key = pair_key(body1, body2);
+  pair->key1 = key.body1;
+  pair->key2 = key.body2;
+  pair->forcer = forcer;
+  pair->aux = aux;
+  pair->order = scene->num_pairs_added++;
+  pair->last_tick = 0;
+
+  list_add(scene->pair_creators, pair);
+}
+
+void scene_add_collision_event(scene_t *scene, collision_event_t event) {
+  assert(!scene->dispatching);
+  if (scene->num_events == scene->event_capacity) {
+    scene->event_capacity =
+        scene->event_capacity == 0 ? SCENE_CAPACITY : 2 * scene->event_capacity;
+    scene->events = realloc(scene->events, sizeof(collision_event_t) *
+                                               scene->event_capacity);
+    scene->event_groups =
+        realloc(scene->event_groups, sizeof(size_t) * scene->event_capacity);
+    scene->event_order =
+        realloc(scene->event_order, sizeof(size_t) * scene->event_capacity);
+    scene->group_starts = realloc(scene->group_starts,
+                                  sizeof(size_t) * (scene->event_capacity + 1));
+    assert(scene->events && scene->event_groups);
+    assert(scene->event_order && scene->group_starts);
+  }
+  scene->events[scene->num_events++] = event;
+}
+
+void scene_add_contact(scene_t *scene, contact_constraint_t contact) {
+  if (scene->num_contacts == scene->contact_capacity) {
+    scene->contact_capacity = scene->contact_capacity == 0
+                                  ? SCENE_CAPACITY
+                                  : 2 * scene->contact_capacity;
+    scene->contacts = realloc(scene->contacts, sizeof(contact_constraint_t) *
+                                                   scene->contact_capacity);
+    assert(scene->contacts);
+  }
+  scene->contacts[scene->num_contacts++] = contact;
+}
+
+size_t scene_num_collision_events(scene_t *scene) { return scene->num_events; }
+
+collision_event_t scene_get_collision_event(scene_t *scene, size_t index) {
+  assert(index < scene->num_events);
+  return scene->events[index];
+}
+
+static bool same_handler(collision_event_t *event1, collision_event_t *event2) {
+  return event1->handler == event2->handler && event1->aux == event2->aux &&
+         event1->force_const == event2->force_const;
+}
+
+static size_t handler_hash(collision_event_t *event) {
+  return ((uintptr_t)event->handler * HANDLER_HASH_PRIME) ^
+         (uintptr_t)event->aux;
+}
+
+/**
+ * Calls the handlers of the tick's collision events, grouped by handler.
+ * The groups are in the order their first event was found, and each group's
+ * events are in the order they were found, so the order doesn't depend on
+ * where the handlers are in memory.
+ */
+static void dispatch_collision_events(scene_t *scene) {
+  size_t num_events = scene->num_events;
+  if (num_events == 0) {
+    return;
+  }
+  collision_event_t *events = scene->events;
+  size_t *groups = scene->event_groups;
+
+  size_t num_slots = MIN_HANDLER_SLOTS;
+  while (num_slots < 2 * num_events) {
+    num_slots *= 2;
+  }
+  // the table only ever grows, but only as much of it as is needed is used
+  if (num_slots > scene->num_handler_slots) {
+    free(scene->handler_slots);
+    scene->handler_slots = malloc(sizeof(size_t) * num_slots);
+    assert(scene->handler_slots);
+    scene->num_handler_slots = num_slots;
+  }
+  size_t *slots = scene->handler_slots;
+  for (size_t i = 0; i < num_slots; i++) {
+    slots[i] = EMPTY_HANDLER_SLOT;
+  }
+
+  // number the handlers in the order their first event was found; each slot
+  // holds the first event with its handler
+  size_t num_groups = 0;
+  for (size_t i = 0; i < num_events; i++) {
+    size_t slot = handler_hash(&events[i]) & (num_slots - 1);
+    while (slots[slot] != EMPTY_HANDLER_SLOT &&
+           !same_handler(&events[slots[slot]], &events[i])) {
+      slot = (slot + 1) & (num_slots - 1);
+    }
+    if (slots[slot] == EMPTY_HANDLER_SLOT) {
+      slots[slot] = i;
+      groups[i] = num_groups++;
+    } else {
+      groups[i] = groups[slots[slot]];
+    }
+  }
+
+  // a counting sort, keeping each group's events in the order they were found
+  size_t *starts = scene->group_starts;
+  size_t *order = scene->event_order;
+  for (size_t k = 0; k <= num_groups; k++) {
+    starts[k] = 0;
+  }
+  for (size_t i = 0; i < num_events; i++) {
+    starts[groups[i] + 1]++;
+  }
+  for (size_t k = 1; k <= num_groups; k++) {
+    starts[k] += starts[k - 1];
+  }
+  for (size_t i = 0; i < num_events; i++) {
+    order[starts[groups[i]]++] = i;
+  }
+
+  scene->dispatching = true;
+  for (size_t j = 0; j < num_events; j++) {
+    collision_event_t *event = &events[order[j]];
+    if (event->handler != NULL) {
+      event->handler(event->body1, event->body2, event->axis, event->aux,
+                     event->force_const);
+    }
+  }
+  scene->dispatching = false;
+}
+
+/**
+ * Finds the index of the first pair force creator registered on a key,
+ * searching only the sorted prefix of the pair force creators.
+ *
+ * @return the index of the first force creator whose key is not less than
+ * the given key
+ */
+static size_t find_pair_force_creator(scene_t *scene, pair_t key) {
+  size_t low = 0;
+  size_t high = scene->num_sorted_pairs;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    pair_force_creator_t *pair = list_get(scene->pair_creators, mid);
+    if (compare_keys(pair->key1, pair->key2, key.body1, key.body2) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/**
+ * Removes and frees every pair force creator acting on a body.
+ */
+static void remove_pair_force_creators(scene_t *scene, body_t *body) {
+  for (ssize_t j = 0; j < (ssize_t)list_size(scene->pair_creators); j++) {
+    pair_force_creator_t *pair = list_get(scene->pair_creators, j);
+    if (pair->key1 != body && pair->key2 != body) {
+      continue;
+    }
+
+    for (size_t k = 0; k < list_size(scene->touching_pairs); k++) {
+      if (list_get(scene->touching_pairs, k) == pair) {
+        list_remove(scene->touching_pairs, k);
+        break;
+      }
+    }
+
+    list_remove(scene->pair_creators, j);
+    if ((size_t)j < scene->num_sorted_pairs) {
+      scene->num_sorted_pairs--;
+    }
+    pair_force_creator_free(pair);
+    j--;
+  }
+}
+
+static int compare_layer_contacts(const void *p1, const void *p2) {
+  pair_t *pair1 = *(pair_t **)p1;
+  pair_t *pair2 = *(pair_t **)p2;
+  return compare_keys(pair1->body1, pair1->body2, pair2->body1, pair2->body2);
+}
+
+/**
+ * Checks whether a pair of bodies was colliding through a layer handler on
+ * the tick before. The previous tick's contacts are sorted by key.
+ */
+static bool was_layer_contact(scene_t *scene, pair_t key) {
+  list_t *contacts = scene->prev_layer_contacts;
+  size_t low = 0;
+  size_t high = list_size(contacts);
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    pair_t *contact = list_get(contacts, mid);
+    int order =
+        compare_keys(contact->body1, contact->body2, key.body1, key.body2);
+    if (order == 0) {
+      return true;
+    }
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return false;
+}
+
+/**
+ * Removes every layer contact involving a body, so a new body allocated at
+ * the same address doesn't inherit it.
+ */
+static void remove_layer_contacts(scene_t *scene, body_t *body) {
+  for (ssize_t i = 0; i < (ssize_t)list_size(scene->layer_contacts); i++) {
+    pair_t *contact = list_get(scene->layer_contacts, i);
+    if (contact->body1 == body || contact->body2 == body) {
+      free(list_remove(scene->layer_contacts, i));
+      i--;
+    }
+  }
+}
+
+/**
+ * Runs the narrowphase on the pairs found by the broadphase in [start, end)
+ * that have a layer handler. Only reads the bodies, so the pairs can be
+ * split between threads.
+ */
+static void find_layer_collisions(void *aux, size_t start, size_t end) {
+  scene_t *scene = aux;
+  // the pairs to test are packed from start on, so ranges don't share any
+  pair_t *pairs = &scene->narrowphase_pairs[start];
+  collision_info_t *infos = &scene->narrowphase_infos[start];
+  size_t num_tests = 0;
+  for (size_t i = start; i < end; i++) {
+    pair_t candidate = broadphase_get_pair(scene->broadphase, i);
+    body_t *body1 = candidate.body1;
+    body_t *body2 = candidate.body2;
+    layer_collision_t *collision = &scene->layer_collisions[i];
+
+    collision->entry =
+        &scene->layer_handlers[body_get_layer(body1) * NUM_COLLISION_LAYERS +
+                               body_get_layer(body2)];
+    if (collision->entry->handler == NULL ||
+        !body_layers_collide(body1, body2) ||
+        !aabb_overlap(body_get_aabb(body1), body_get_aabb(body2))) {
+      collision->entry = NULL;
+      continue;
+    }
+    pairs[num_tests++] = candidate;
+  }
+
+  if (scene->narrowphase == NARROWPHASE_SAT) {
+    find_collisions_batch(pairs, num_tests, infos);
+  } else {
+    for (size_t j = 0; j < num_tests; j++) {
+      infos[j] = find_collision_with(scene->narrowphase, pairs[j].body1,
+                                     pairs[j].body2);
+    }
+  }
+  size_t j = 0;
+  for (size_t i = start; i < end; i++) {
+    if (scene->layer_collisions[i].entry != NULL) {
+      scene->layer_collisions[i].info = infos[j++];
+    }
+  }
+}
+
+static bool was_rewound(scene_t *scene, body_t *body) {
+  for (size_t i = 0; i < list_size(scene->rewound_bodies); i++) {
+    if (list_get(scene->rewound_bodies, i) == body) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Queues a collision event for the layer handler of a pair of bodies found
+ * by the broadphase, given the pair's narrowphase result from
+ * find_layer_collisions(). Like create_collision(), an event is only queued
+ * on the first tick the bodies collide.
+ */
+static void queue_layer_collision(scene_t *scene, pair_t candidate, pair_t key,
+                                  layer_collision_t *collision) {
+  layer_handler_t *entry = collision->entry;
+  if (entry == NULL) {
+    return;
+  }
+
+  body_t *body1 = candidate.body1;
+  body_t *body2 = candidate.body2;
+  collision_info_t info = collision->info;
+  // moving a bullet back to where it hit something invalidates its other
+  // pairs' results
+  if (was_rewound(scene, body1) || was_rewound(scene, body2)) {
+    info = find_collision_with(scene->narrowphase, body1, body2);
+  }
+  // like find_collision_swept(), this has to run in order, since it moves
+  // the bodies
+  if (!info.collided && (body_is_bullet(body1) || body_is_bullet(body2))) {
+    double time;
+    info = find_time_of_impact(body1, body2, &time);
+    if (info.collided) {
+      body_rewind(body1, time);
+      body_rewind(body2, time);
+      list_add(scene->rewound_bodies, body1);
+      list_add(scene->rewound_bodies, body2);
+    }
+  }
+  if (!info.collided) {
+    return;
+  }
+
+  pair_t *contact = malloc(sizeof(pair_t));
+  assert(contact);
+  *contact = key;
+  list_add(scene->layer_contacts, contact);
+  if (was_layer_contact(scene, key)) {
+    return;
+  }
+
+  collision_event_t event;
+  if (entry->swapped) {
+    info.axis = vec_negate(info.axis);
+    event = find_collision_event(body2, body1, info);
+  } else {
+    event = find_collision_event(body1, body2, info);
+  }
+  event.handler = entry->handler;
+  event.aux = entry->aux;
+  event.force_const = entry->force_const;
+  scene_add_collision_event(scene, event);
+}
+
+/**
+ * Runs the layer handlers and pair force creators for the pairs of bodies
+ * found by the broadphase, then the pair force creators whose bodies have
+ * separated since last tick, then solves the contacts they queued, then
+ * runs the handlers of the collision events they queued.
+ */
+static void run_pair_force_creators(scene_t *scene, double dt) {
+  if (scene->num_sorted_pairs != list_size(scene->pair_creators)) {
+    list_sort(scene->pair_creators, compare_pair_force_creators);
+    scene->num_sorted_pairs = list_size(scene->pair_creators);
+  }
+
+  list_t *prev_touching = scene->touching_pairs;
+  scene->touching_pairs = scene->prev_touching_pairs;
+  scene->prev_touching_pairs = prev_touching;
+  while (list_size(scene->touching_pairs) > 0) {
+    list_remove(scene->touching_pairs, list_size(scene->touching_pairs) - 1);
+  }
+  scene->tick++;
+
+  list_t *prev_contacts = scene->layer_contacts;
+  scene->layer_contacts = scene->prev_layer_contacts;
+  scene->prev_layer_contacts = prev_contacts;
+  while (list_size(scene->layer_contacts) > 0) {
+    free(list_remove(scene->layer_contacts,
+                     list_size(scene->layer_contacts) - 1));
+  }
+
+  while (list_size(scene->rewound_bodies) > 0) {
+    list_remove(scene->rewound_bodies, list_size(scene->rewound_bodies) - 1);
+  }
+
+  broadphase_update(scene->broadphase, scene->bodies);
+  scene->broadphase_stale = false;
+  scene->finding_pairs = true;
+
+  // the narrowphase for every layer pair runs up front, split between the
+  // scene's threads, then their events are queued one at a time in pair order
+  size_t num_candidates = broadphase_num_pairs(scene->broadphase);
+  if (num_candidates > scene->layer_collisions_capacity) {
+    scene->layer_collisions_capacity = 2 * num_candidates;
+    free(scene->layer_collisions);
+    free(scene->narrowphase_pairs);
+    free(scene->narrowphase_infos);
+    scene->layer_collisions = malloc(sizeof(layer_collision_t) *
+                                     scene->layer_collisions_capacity);
+    scene->narrowphase_pairs =
+        malloc(sizeof(pair_t) * scene->layer_collisions_capacity);
+    scene->narrowphase_infos =
+        malloc(sizeof(collision_info_t) * scene->layer_collisions_capacity);
+    assert(scene->layer_collisions);
+    assert(scene->narrowphase_pairs);
+    assert(scene->narrowphase_infos);
+  }
+  // reading the vertices of a body that moved updates them, so they have to
+  // be brought up to date before the threads share the bodies
+  if (thread_pool_num_threads(scene->pool) > 1) {
+    for (size_t i = 0; i < num_candidates; i++) {
+      pair_t candidate = broadphase_get_pair(scene->broadphase, i);
+      polygon_update_vertices(body_get_collision_polygon(candidate.body1));
+      polygon_update_vertices(body_get_collision_polygon(candidate.body2));
+    }
+  }
+  thread_pool_for(scene->pool, num_candidates, find_layer_collisions, scene);
+
+  // force creators may register new pairs, which are not searched this tick
+  size_t num_sorted = scene->num_sorted_pairs;
+  for (size_t i = 0; i < num_candidates; i++) {
+    pair_t candidate = broadphase_get_pair(scene->broadphase, i);
+    pair_t key = pair_key(candidate.body1, candidate.body2);
+    queue_layer_collision(scene, candidate, key,
+                          &scene->layer_collisions[i]);
+
+    for (size_t j = find_pair_force_creator(scene, key); j < num_sorted; j++) {
+      pair_force_creator_t *pair = list_get(scene->pair_creators, j);
+      if (pair->key1 != key.body1 || pair->key2 != key.body2) {
+        break;
+      }
+      pair->forcer(pair->aux);
+      pair->last_tick = scene->tick;
+      list_add(scene->touching_pairs, pair);
+    }
+  }
+
+  for (size_t i = 0; i < list_size(prev_touching); i++) {
+    pair_force_creator_t *pair = list_get(prev_touching, i);
+    if (pair->last_tick != scene->tick) {
+      pair->forcer(pair->aux);
+    }
+  }
+  list_sort(scene->layer_contacts, compare_layer_contacts);
+  scene->finding_pairs = false;
+
+  solve_contacts(scene->contacts, scene->num_contacts, dt);
+  dispatch_collision_events(scene);
+}
+
 void scene_tick(scene_t *scene, double dt) {
+  scene->num_events = 0;
+  scene->num_contacts = 0;
   for (ssize_t i = 0; i < (ssize_t)(scene->num_bodies); i++) {
     body_t *curr = scene_get_body(scene, i);
 
@@ -100,9 +777,12 @@ void scene_tick(scene_t *scene, double dt) {
           }
         }
       }
+      remove_pair_force_creators(scene, curr);
+      remove_layer_contacts(scene, curr);
 
       list_remove(scene->bodies, i);
       body_free(curr);
+      scene->broadphase_stale = true;
       i--;
       scene->num_bodies--;
     } else {
@@ -114,4 +794,73 @@ void scene_tick(scene_t *scene, double dt) {
     force_creator_t force = list_get(scene->force_creators, h);
     force(list_get(scene->auxs, h));
   }
+
+  run_pair_force_creators(scene, dt);
+}
+
+/**
+ * Brings the broadphase up to date with bodies added or freed since the
+ * last tick, so queries can use it. While the pairs it found are being run
+ * it can't change, but bodies are only freed at the start of a tick, so
+ * it only misses the bodies added since.
+ */
+static broadphase_t *query_broadphase(scene_t *scene) {
+  if (scene->broadphase_stale && !scene->finding_pairs) {
+    broadphase_update(scene->broadphase, scene->bodies);
+    scene->broadphase_stale = false;
+  }
+  while (list_size(scene->query_results) > 0) {
+    list_remove(scene->query_results, list_size(scene->query_results) - 1);
+  }
+  return scene->broadphase;
+}
+
+size_t scene_query_aabb(scene_t *scene, aabb_t bounds, list_t *found) {
+  list_t *candidates = scene->query_results;
+  broadphase_query(query_broadphase(scene), bounds, candidates);
+
+  size_t num_found = 0;
+  for (size_t i = 0; i < list_size(candidates); i++) {
+    body_t *body = list_get(candidates, i);
+    // the broadphase has the bounds from the last tick
+    if (!body_is_removed(body) && aabb_overlap(body_get_aabb(body), bounds)) {
+      list_add(found, body);
+      num_found++;
+    }
+  }
+  return num_found;
+}
+
+size_t scene_query_point(scene_t *scene, vector_t point, list_t *found) {
+  list_t *candidates = scene->query_results;
+  broadphase_query(query_broadphase(scene), (aabb_t){point, point},
+                   candidates);
+
+  size_t num_found = 0;
+  for (size_t i = 0; i < list_size(candidates); i++) {
+    body_t *body = list_get(candidates, i);
+    if (!body_is_removed(body) && point_in_body(body, point)) {
+      list_add(found, body);
+      num_found++;
+    }
+  }
+  return num_found;
+}
+
+bool scene_raycast(scene_t *scene, vector_t start, vector_t end,
+                   ray_hit_t *hit) {
+  list_t *candidates = scene->query_results;
+  broadphase_query_segment(query_broadphase(scene), start, end, candidates);
+
+  bool found = false;
+  for (size_t i = 0; i < list_size(candidates); i++) {
+    body_t *body = list_get(candidates, i);
+    ray_hit_t body_hit;
+    if (!body_is_removed(body) && find_ray_hit(body, start, end, &body_hit) &&
+        (!found || body_hit.fraction < hit->fraction)) {
+      *hit = body_hit;
+      found = true;
+    }
+  }
+  return found;
 }
@@ -175,21 +175,42 @@ void sdl_clear(void) {
 }
 
 void sdl_draw_polygon(polygon_t *poly, rgb_color_t color) {
-  list_t *points = polygon_get_points(poly);
+  vector_t window_center = get_window_center();
+
+  if (polygon_get_type(poly) == SHAPE_CIRCLE) {
+    vector_t pixel =
+        get_window_position(polygon_get_center(poly), window_center);
+    double scale = get_scene_scale(window_center);
+    filledCircleRGBA(renderer, pixel.x, pixel.y,
+                     polygon_get_radius(poly) * scale, color.r * 255,
+                     color.g * 255, color.b * 255, 255);
+    return;
+  }
+
+  const vector_t *vertices = polygon_get_vertices(poly);
+  size_t n = polygon_get_num_vertices(poly);
+  // a half-plane has no vertices, and reaches past the edge of the window
+  if (n == 0) {
+    return;
+  }
+  // a segment is drawn as a line
+  if (n == 2) {
+    vector_t start = get_window_position(vertices[0], window_center);
+    vector_t end = get_window_position(vertices[1], window_center);
+    lineRGBA(renderer, start.x, start.y, end.x, end.y, color.r * 255,
+             color.g * 255, color.b * 255, 255);
+    return;
+  }
   // Check parameters
-  size_t n = list_size(points);
   assert(n >= 3);
 
-  vector_t window_center = get_window_center();
-
   // Convert each vertex to a point on screen
   int16_t *x_points = malloc(sizeof(*x_points) * n),
           *y_points = malloc(sizeof(*y_points) * n);
   assert(x_points != NULL);
   assert(y_points != NULL);
   for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
+    vector_t pixel = get_window_position(vertices[i], window_center);
     x_points[i] = pixel.x;
     y_points[i] = pixel.y;
   }
@@ -225,10 +246,7 @@ void sdl_render_scene(scene_t *scene, void *aux) {
   size_t body_count = scene_bodies(scene);
   for (size_t i = 0; i < body_count; i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-    polygon_t *poly = polygon_init(shape, (vector_t){0, 0}, 0, 0, 0, 0);
-    sdl_draw_polygon(poly, *body_get_color(body));
-    list_free(shape);
+    sdl_draw_polygon(body_get_polygon(body), *body_get_color(body));
   }
   if (aux != NULL) {
     body_t *body = aux;
@@ -328,21 +346,31 @@ SDL_Rect make_bounding_box(body_t *body) {
   double bottom_most = __DBL_MAX__;
   double top_most = -__DBL_MAX__;
 
-  list_t *edges = body_get_shape(body);
+  // a circle has no vertices, so is bounded by its radius
+  polygon_t *poly = body_get_polygon(body);
+  if (polygon_get_type(poly) == SHAPE_CIRCLE) {
+    vector_t center = polygon_get_center(poly);
+    double radius = polygon_get_radius(poly);
+    left_most = center.x - radius;
+    right_most = center.x + radius;
+    bottom_most = center.y - radius;
+    top_most = center.y + radius;
+  }
 
-  for (size_t i = 0; i < list_size(edges); i++) {
-    vector_t *curr = list_get(edges, i);
-    if (curr->x < left_most) {
-      left_most = curr->x;
+  vertex_span_t span = body_get_vertices(body);
+  for (size_t i = 0; i < span.num_vertices; i++) {
+    vector_t curr = span.vertices[i];
+    if (curr.x < left_most) {
+      left_most = curr.x;
     }
-    if (curr->x > right_most) {
-      right_most = curr->x;
+    if (curr.x > right_most) {
+      right_most = curr.x;
     }
-    if (curr->y < bottom_most) {
-      bottom_most = curr->y;
+    if (curr.y < bottom_most) {
+      bottom_most = curr.y;
     }
-    if (curr->y > top_most) {
-      top_most = curr->y;
+    if (curr.y > top_most) {
+      top_most = curr.y;
     }
   }
 
@@ -358,6 +386,5 @@ SDL_Rect make_bounding_box(body_t *body) {
                   new_bottom_right.x - new_top_left.x,
                   new_bottom_right.y - new_top_left.y};
 
-  list_free(edges);
   return ret;
 }
@@ -0,0 +1,155 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+typedef struct worker {
+  thread_pool_t *pool;
+  size_t index;
+} worker_t;
+
+struct thread_pool {
+  // the threads started, not counting the thread calling thread_pool_for()
+  size_t num_workers;
+  pthread_t *threads;
+  worker_t *workers;
+
+  pthread_mutex_t lock;
+  pthread_cond_t work_ready;
+  pthread_cond_t work_done;
+  // counts the loops started, so workers can tell a new loop has begun
+  size_t generation;
+  size_t num_busy;
+  bool stopping;
+
+  range_func_t func;
+  void *aux;
+  size_t count;
+};
+
+/**
+ * Runs the range of a loop belonging to one thread.
+ * Thread 0 is the thread calling thread_pool_for().
+ */
+static void run_range(thread_pool_t *pool, size_t index, range_func_t func,
+                      void *aux, size_t count) {
+  size_t num_threads = pool->num_workers + 1;
+  size_t start = count * index / num_threads;
+  size_t end = count * (index + 1) / num_threads;
+  if (start < end) {
+    func(aux, start, end);
+  }
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  thread_pool_t *pool = worker->pool;
+  size_t seen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (pool->generation == seen && !pool->stopping) {
+      pthread_cond_wait(&pool->work_ready, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    seen = pool->generation;
+    range_func_t func = pool->func;
+    void *aux = pool->aux;
+    size_t count = pool->count;
+    pthread_mutex_unlock(&pool->lock);
+
+    run_range(pool, worker->index, func, aux, count);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->num_busy--;
+    if (pool->num_busy == 0) {
+      pthread_cond_signal(&pool->work_done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+thread_pool_t *thread_pool_init(size_t num_threads) {
+  assert(num_threads > 0);
+  thread_pool_t *pool = malloc(sizeof(thread_pool_t));
+  assert(pool);
+
+  pool->threads = malloc(sizeof(pthread_t) * num_threads);
+  assert(pool->threads);
+  pool->workers = malloc(sizeof(worker_t) * num_threads);
+  assert(pool->workers);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_ready, NULL);
+  pthread_cond_init(&pool->work_done, NULL);
+  pool->generation = 0;
+  pool->num_busy = 0;
+  pool->stopping = false;
+  pool->func = NULL;
+  pool->aux = NULL;
+  pool->count = 0;
+
+  pool->num_workers = 0;
+  for (size_t i = 1; i < num_threads; i++) {
+    pool->workers[i] = (worker_t){pool, i};
+    if (pthread_create(&pool->threads[pool->num_workers], NULL, worker_main,
+                       &pool->workers[i]) != 0) {
+      break;
+    }
+    pool->num_workers++;
+  }
+
+  return pool;
+}
+
+size_t thread_pool_num_threads(thread_pool_t *pool) {
+  return pool->num_workers + 1;
+}
+
+void thread_pool_for(thread_pool_t *pool, size_t count, range_func_t func,
+                     void *aux) {
+  if (pool->num_workers == 0) {
+    if (count > 0) {
+      func(aux, 0, count);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->func = func;
+  pool->aux = aux;
+  pool->count = count;
+  pool->num_busy = pool->num_workers;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->work_ready);
+  pthread_mutex_unlock(&pool->lock);
+
+  run_range(pool, 0, func, aux, count);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->num_busy > 0) {
+    pthread_cond_wait(&pool->work_done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_free(thread_pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->work_ready);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->num_workers; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work_ready);
+  pthread_cond_destroy(&pool->work_done);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
+}
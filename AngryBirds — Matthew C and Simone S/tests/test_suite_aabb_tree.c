@@ -0,0 +1,95 @@
+#include "aabb_tree.h"
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t NUM_BOXES = 200;
+
+aabb_t random_box() {
+  vector_t min = {rand() % 1000, rand() % 1000};
+  vector_t size = {1 + rand() % 60, 1 + rand() % 60};
+  return (aabb_t){min, vec_add(min, size)};
+}
+
+void count_found(size_t value, void *aux) {
+  size_t *found = aux;
+  found[value]++;
+}
+
+void test_tree_query() {
+  aabb_tree_t *tree = aabb_tree_init();
+  aabb_t boxes[NUM_BOXES];
+  size_t leaves[NUM_BOXES];
+  bool present[NUM_BOXES];
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    boxes[i] = random_box();
+    leaves[i] = aabb_tree_insert(tree, boxes[i], i);
+    present[i] = true;
+    assert(vec_equal(aabb_tree_get_bounds(tree, leaves[i]).min, boxes[i].min));
+  }
+
+  for (size_t round = 0; round < 50; round++) {
+    // move some boxes and remove or re-add others
+    for (size_t k = 0; k < 20; k++) {
+      size_t i = rand() % NUM_BOXES;
+      if (present[i]) {
+        aabb_tree_remove(tree, leaves[i]);
+        present[i] = rand() % 2 == 0;
+      } else {
+        present[i] = true;
+      }
+      if (present[i]) {
+        boxes[i] = random_box();
+        leaves[i] = aabb_tree_insert(tree, boxes[i], i);
+      }
+    }
+
+    aabb_t query = random_box();
+    query.max = vec_add(query.max, (vector_t){100, 100});
+    size_t found[NUM_BOXES];
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      found[i] = 0;
+    }
+    aabb_tree_query(tree, query, count_found, found);
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      assert(found[i] == (present[i] && aabb_overlap(boxes[i], query)));
+    }
+  }
+
+  aabb_tree_free(tree);
+}
+
+void test_tree_values() {
+  aabb_tree_t *tree = aabb_tree_init();
+  aabb_t box = {{0, 0}, {10, 10}};
+  size_t leaf = aabb_tree_insert(tree, box, 3);
+  aabb_tree_insert(tree, (aabb_t){{20, 20}, {30, 30}}, 4);
+  aabb_tree_set_value(tree, leaf, 1);
+
+  size_t found[5] = {0};
+  // touching boxes count as overlapping
+  aabb_tree_query(tree, (aabb_t){{10, 10}, {15, 15}}, count_found, found);
+  assert(found[1] == 1 && found[3] == 0 && found[4] == 0);
+
+  aabb_tree_remove(tree, leaf);
+  aabb_tree_query(tree, (aabb_t){{-100, -100}, {100, 100}}, count_found, found);
+  assert(found[1] == 1 && found[4] == 1);
+
+  aabb_tree_free(tree);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_tree_query)
+  DO_TEST(test_tree_values)
+
+  puts("aabb_tree_test PASS");
+}
@@ -0,0 +1,412 @@
+#include "broadphase.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+list_t *make_square(vector_t center, double side) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {+1, -1}, {+1, +1}, {-1, +1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = vec_add(center, vec_multiply(side / 2, corners[i]));
+    list_add(shape, v);
+  }
+  return shape;
+}
+
+body_t *make_body(list_t *bodies, vector_t center, double side) {
+  body_t *body = body_init(make_square(center, side), 1, (rgb_color_t){0, 0, 0});
+  list_add(bodies, body);
+  return body;
+}
+
+void test_broadphase_overlaps() {
+  list_t *bodies = list_init(4, (free_func_t)body_free);
+  body_t *a = make_body(bodies, (vector_t){0, 0}, 10);
+  body_t *far = make_body(bodies, (vector_t){500, 500}, 10);
+  body_t *b = make_body(bodies, (vector_t){8, 0}, 10);
+  // spans many cells, so it is checked against everything
+  body_t *ground = make_body(bodies, (vector_t){0, -50}, 10000);
+
+  broadphase_t *broadphase = broadphase_init(100);
+  broadphase_update(broadphase, bodies);
+
+  // pairs come out in list order: (a, b), (a, ground), (far, ground), (b, ground)
+  assert(broadphase_num_pairs(broadphase) == 4);
+  pair_t pair = broadphase_get_pair(broadphase, 0);
+  assert(pair.body1 == a && pair.body2 == b);
+  pair = broadphase_get_pair(broadphase, 1);
+  assert(pair.body1 == a && pair.body2 == ground);
+  pair = broadphase_get_pair(broadphase, 2);
+  assert(pair.body1 == far && pair.body2 == ground);
+  pair = broadphase_get_pair(broadphase, 3);
+  assert(pair.body1 == b && pair.body2 == ground);
+
+  broadphase_free(broadphase);
+  list_free(bodies);
+}
+
+void test_broadphase_moving() {
+  list_t *bodies = list_init(2, (free_func_t)body_free);
+  body_t *a = make_body(bodies, (vector_t){0, 0}, 30);
+  body_t *b = make_body(bodies, (vector_t){1000, 0}, 30);
+
+  broadphase_t *broadphase = broadphase_init(25);
+  broadphase_update(broadphase, bodies);
+  assert(broadphase_num_pairs(broadphase) == 0);
+
+  // bodies sharing several cells are only reported once
+  body_set_centroid(b, (vector_t){10, 10});
+  broadphase_update(broadphase, bodies);
+  assert(broadphase_num_pairs(broadphase) == 1);
+  pair_t pair = broadphase_get_pair(broadphase, 0);
+  assert(pair.body1 == a && pair.body2 == b);
+
+  // touching bounds count as overlapping
+  body_set_centroid(b, (vector_t){30, -30});
+  broadphase_update(broadphase, bodies);
+  assert(broadphase_num_pairs(broadphase) == 1);
+
+  body_set_centroid(b, (vector_t){-31, 0});
+  broadphase_update(broadphase, bodies);
+  assert(broadphase_num_pairs(broadphase) == 0);
+
+  broadphase_free(broadphase);
+  list_free(bodies);
+}
+
+void test_sweep_and_prune_matches_grid() {
+  list_t *bodies = list_init(32, (free_func_t)body_free);
+  for (size_t i = 0; i < 30; i++) {
+    make_body(bodies, (vector_t){rand() % 400, rand() % 400}, 5 + rand() % 40);
+  }
+  // spans the whole x axis, like the ground
+  make_body(bodies, (vector_t){200, -500}, 1010);
+
+  broadphase_t *grid = broadphase_init(25);
+  broadphase_t *sweep = broadphase_init_sweep_and_prune();
+  for (size_t tick = 0; tick < 50; tick++) {
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      vector_t step = {rand() % 21 - 10, rand() % 21 - 10};
+      body_set_centroid(body, vec_add(body_get_centroid(body), step));
+    }
+    // bodies come and go like they do in a scene
+    if (tick % 7 == 3) {
+      body_free(list_remove(bodies, rand() % list_size(bodies)));
+    }
+    if (tick % 5 == 1) {
+      make_body(bodies, (vector_t){rand() % 400, rand() % 400}, 20);
+    }
+
+    broadphase_update(grid, bodies);
+    broadphase_update(sweep, bodies);
+    assert(broadphase_num_pairs(sweep) == broadphase_num_pairs(grid));
+    for (size_t i = 0; i < broadphase_num_pairs(grid); i++) {
+      pair_t expected = broadphase_get_pair(grid, i);
+      pair_t actual = broadphase_get_pair(sweep, i);
+      assert(actual.body1 == expected.body1 && actual.body2 == expected.body2);
+    }
+  }
+
+  broadphase_free(grid);
+  broadphase_free(sweep);
+  list_free(bodies);
+}
+
+void test_tree_skips_static_pairs() {
+  list_t *bodies = list_init(64, (free_func_t)body_free);
+  for (size_t i = 0; i < 40; i++) {
+    list_t *shape =
+        make_square((vector_t){rand() % 400, rand() % 400}, 5 + rand() % 40);
+    double mass = i % 3 == 0 ? __DBL_MAX__ : 1;
+    list_add(bodies, body_init(shape, mass, (rgb_color_t){0, 0, 0}));
+  }
+
+  broadphase_t *grid = broadphase_init(25);
+  broadphase_t *tree = broadphase_init_tree();
+  for (size_t tick = 0; tick < 50; tick++) {
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      // static bodies can still be moved by hand
+      if (!body_is_static(body) || tick % 10 == 0) {
+        vector_t step = {rand() % 21 - 10, rand() % 21 - 10};
+        body_set_centroid(body, vec_add(body_get_centroid(body), step));
+      }
+    }
+    if (tick % 7 == 3) {
+      body_free(list_remove(bodies, rand() % list_size(bodies)));
+    }
+    if (tick % 5 == 1) {
+      make_body(bodies, (vector_t){rand() % 400, rand() % 400}, 20);
+    }
+
+    broadphase_update(grid, bodies);
+    broadphase_update(tree, bodies);
+    size_t t = 0;
+    for (size_t i = 0; i < broadphase_num_pairs(grid); i++) {
+      pair_t expected = broadphase_get_pair(grid, i);
+      if (body_is_static(expected.body1) && body_is_static(expected.body2)) {
+        continue;
+      }
+      pair_t actual = broadphase_get_pair(tree, t++);
+      assert(actual.body1 == expected.body1 && actual.body2 == expected.body2);
+    }
+    assert(t == broadphase_num_pairs(tree));
+  }
+
+  broadphase_free(grid);
+  broadphase_free(tree);
+  list_free(bodies);
+}
+
+// Tests that box and segment queries find exactly the bodies a scan of
+// every body finds, in list order, for every kind of broadphase
+void test_queries_match_scan() {
+  list_t *bodies = list_init(64, (free_func_t)body_free);
+  for (size_t i = 0; i < 50; i++) {
+    make_body(bodies, (vector_t){rand() % 400, rand() % 400}, 5 + rand() % 40);
+  }
+  make_body(bodies, (vector_t){200, -500}, 1010);
+
+  broadphase_t *broadphases[] = {broadphase_init(25),
+                                 broadphase_init_sweep_and_prune(),
+                                 broadphase_init_tree()};
+  list_t *found = list_init(64, NULL);
+  for (size_t b = 0; b < 3; b++) {
+    broadphase_update(broadphases[b], bodies);
+    for (size_t q = 0; q < 100; q++) {
+      vector_t start = {rand() % 500 - 50, rand() % 500 - 50};
+      vector_t end = {rand() % 500 - 50, rand() % 500 - 50};
+      // mostly small boxes, and a few spanning the whole world
+      if (q % 10 != 0) {
+        end = vec_add(start, (vector_t){rand() % 50, rand() % 50});
+      }
+      aabb_t box = {start, {fmax(start.x, end.x), fmax(start.y, end.y)}};
+
+      broadphase_query(broadphases[b], box, found);
+      size_t f = 0;
+      for (size_t i = 0; i < list_size(bodies); i++) {
+        body_t *body = list_get(bodies, i);
+        if (aabb_overlap(body_get_aabb(body), box)) {
+          assert(list_get(found, f++) == body);
+        }
+      }
+      assert(f == list_size(found));
+      while (list_size(found) > 0) {
+        list_remove(found, 0);
+      }
+
+      broadphase_query_segment(broadphases[b], start, end, found);
+      f = 0;
+      for (size_t i = 0; i < list_size(bodies); i++) {
+        body_t *body = list_get(bodies, i);
+        if (aabb_segment_overlap(body_get_aabb(body), start, end)) {
+          assert(list_get(found, f++) == body);
+        }
+      }
+      assert(f == list_size(found));
+      while (list_size(found) > 0) {
+        list_remove(found, 0);
+      }
+    }
+    broadphase_free(broadphases[b]);
+  }
+
+  list_free(found);
+  list_free(bodies);
+}
+
+// Tests the scene queries built on the broadphase
+void test_scene_queries() {
+  scene_t *scene = scene_init_with_broadphase(BROADPHASE_TREE);
+  list_t *squares = list_init(4, NULL);
+  for (size_t i = 0; i < 4; i++) {
+    body_t *body = body_init(make_square((vector_t){20.0 * i, 0}, 10), 1,
+                             (rgb_color_t){0, 0, 0});
+    scene_add_body(scene, body);
+    list_add(squares, body);
+  }
+  body_t *ball = body_init_circle_with_info((vector_t){20, 30}, 5, 1,
+                                            (rgb_color_t){0, 0, 0}, NULL,
+                                            NULL);
+  scene_add_body(scene, ball);
+
+  // found before the first tick
+  list_t *found = list_init(4, NULL);
+  assert(scene_query_point(scene, (vector_t){41, 4}, found) == 1);
+  assert(list_get(found, 0) == list_get(squares, 2));
+  assert(scene_query_point(scene, (vector_t){50, 0}, found) == 0);
+  assert(scene_query_point(scene, (vector_t){20, 34}, found) == 1);
+  assert(list_get(found, 1) == ball);
+
+  scene_tick(scene, 0.1);
+  list_t *in_box = list_init(4, NULL);
+  aabb_t box = {{12, -2}, {45, 26}};
+  assert(scene_query_aabb(scene, box, in_box) == 3);
+  assert(list_get(in_box, 0) == list_get(squares, 1));
+  assert(list_get(in_box, 1) == list_get(squares, 2));
+  assert(list_get(in_box, 2) == ball);
+
+  ray_hit_t hit;
+  assert(scene_raycast(scene, (vector_t){-20, 1}, (vector_t){100, 1}, &hit));
+  assert(hit.body == list_get(squares, 0));
+  assert(vec_isclose(hit.point, (vector_t){-5, 1}));
+  // removed bodies are skipped
+  body_remove(list_get(squares, 0));
+  assert(scene_raycast(scene, (vector_t){-20, 1}, (vector_t){100, 1}, &hit));
+  assert(hit.body == list_get(squares, 1));
+  assert(scene_raycast(scene, (vector_t){20, 100}, (vector_t){20, -100}, &hit));
+  assert(hit.body == ball);
+  assert(!scene_raycast(scene, (vector_t){-20, 20}, (vector_t){100, 20},
+                        &hit));
+
+  list_free(found);
+  list_free(in_box);
+  list_free(squares);
+  scene_free(scene);
+}
+
+// Tests that every kind of broadphase pairs half-planes, whose bounds reach
+// out to +/-__DBL_MAX__, with exactly the bodies their bounds overlap
+void test_half_plane_pairs() {
+  list_t *bodies = list_init(32, (free_func_t)body_free);
+  for (size_t i = 0; i < 20; i++) {
+    make_body(bodies, (vector_t){rand() % 400, rand() % 400 - 100}, 20);
+  }
+  list_add(bodies, body_init_half_plane_with_info(
+                       (vector_t){0, 0}, (vector_t){0, 1}, 1,
+                       (rgb_color_t){0, 0, 0}, NULL, NULL));
+  list_add(bodies, body_init_half_plane_with_info(
+                       (vector_t){200, 0}, (vector_t){1, -1}, 1,
+                       (rgb_color_t){0, 0, 0}, NULL, NULL));
+
+  broadphase_t *broadphases[] = {broadphase_init(25),
+                                 broadphase_init_sweep_and_prune(),
+                                 broadphase_init_tree()};
+  for (size_t tick = 0; tick < 20; tick++) {
+    for (size_t i = 0; i < 20; i++) {
+      body_t *body = list_get(bodies, i);
+      vector_t step = {rand() % 21 - 10, rand() % 21 - 10};
+      body_set_centroid(body, vec_add(body_get_centroid(body), step));
+    }
+
+    size_t expected = 0;
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      for (size_t j = i + 1; j < list_size(bodies); j++) {
+        expected += aabb_overlap(body_get_aabb(list_get(bodies, i)),
+                                 body_get_aabb(list_get(bodies, j)));
+      }
+    }
+    for (size_t b = 0; b < 3; b++) {
+      broadphase_update(broadphases[b], bodies);
+      assert(broadphase_num_pairs(broadphases[b]) == expected);
+    }
+  }
+
+  for (size_t b = 0; b < 3; b++) {
+    broadphase_free(broadphases[b]);
+  }
+  list_free(bodies);
+}
+
+// Tests that a tree broadphase pairs the game's world bounds like a grid:
+// static walls and a heavy but movable ground, whose unbounded boxes are
+// kept out of its trees, with boxes moving and being added and removed
+void test_tree_world_bounds() {
+  list_t *bodies = list_init(64, (free_func_t)body_free);
+  vector_t max = {1000, 500};
+  list_add(bodies, body_init_half_plane_with_info(
+                       (vector_t){max.x, max.y / 2}, (vector_t){-1, 0},
+                       __DBL_MAX__, (rgb_color_t){0, 0, 0}, NULL, NULL));
+  list_add(bodies, body_init_half_plane_with_info(
+                       (vector_t){0, max.y / 2}, (vector_t){1, 0}, __DBL_MAX__,
+                       (rgb_color_t){0, 0, 0}, NULL, NULL));
+  body_t *ground = body_init_half_plane_with_info(
+      (vector_t){max.x / 2, 0}, (vector_t){0, 1}, 100000,
+      (rgb_color_t){0, 0, 0}, NULL, NULL);
+  assert(!body_is_static(ground));
+  list_add(bodies, ground);
+  for (size_t i = 0; i < 40; i++) {
+    list_t *shape = make_square(
+        (vector_t){rand() % 1000, rand() % 100 - 20}, 5 + rand() % 40);
+    double mass = i % 4 == 0 ? __DBL_MAX__ : 1;
+    list_add(bodies, body_init(shape, mass, (rgb_color_t){0, 0, 0}));
+  }
+
+  broadphase_t *grid = broadphase_init(25);
+  broadphase_t *tree = broadphase_init_tree();
+  list_t *found = list_init(64, NULL);
+  for (size_t tick = 0; tick < 50; tick++) {
+    for (size_t i = 3; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      if (!body_is_static(body)) {
+        vector_t step = {rand() % 21 - 10, rand() % 21 - 10};
+        body_set_centroid(body, vec_add(body_get_centroid(body), step));
+      }
+    }
+    // the ground is pushed around a little by what lands on it
+    body_set_centroid(ground, (vector_t){max.x / 2, rand() % 5 - 2});
+    if (tick % 7 == 3) {
+      body_free(list_remove(bodies, 3 + rand() % (list_size(bodies) - 3)));
+    }
+    if (tick % 5 == 1) {
+      make_body(bodies, (vector_t){rand() % 1000, rand() % 100 - 20}, 20);
+    }
+
+    broadphase_update(grid, bodies);
+    broadphase_update(tree, bodies);
+    size_t t = 0;
+    for (size_t i = 0; i < broadphase_num_pairs(grid); i++) {
+      pair_t expected = broadphase_get_pair(grid, i);
+      if (body_is_static(expected.body1) && body_is_static(expected.body2)) {
+        continue;
+      }
+      pair_t actual = broadphase_get_pair(tree, t++);
+      assert(actual.body1 == expected.body1 && actual.body2 == expected.body2);
+    }
+    assert(t == broadphase_num_pairs(tree));
+
+    aabb_t box = {{rand() % 1000, -20}, {rand() % 1000 + 50, 30}};
+    broadphase_query(tree, box, found);
+    size_t f = 0;
+    for (size_t i = 0; i < list_size(bodies); i++) {
+      body_t *body = list_get(bodies, i);
+      if (aabb_overlap(body_get_aabb(body), box)) {
+        assert(list_get(found, f++) == body);
+      }
+    }
+    assert(f == list_size(found));
+    while (list_size(found) > 0) {
+      list_remove(found, 0);
+    }
+  }
+
+  list_free(found);
+  broadphase_free(grid);
+  broadphase_free(tree);
+  list_free(bodies);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_broadphase_overlaps)
+  DO_TEST(test_broadphase_moving)
+  DO_TEST(test_sweep_and_prune_matches_grid)
+  DO_TEST(test_tree_skips_static_pairs)
+  DO_TEST(test_queries_match_scan)
+  DO_TEST(test_scene_queries)
+  DO_TEST(test_half_plane_pairs)
+  DO_TEST(test_tree_world_bounds)
+
+  puts("broadphase_test PASS");
+}
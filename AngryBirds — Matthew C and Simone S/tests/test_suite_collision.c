@@ -1 +1,875 @@
-int main() { return 0; }
\ No newline at end of file
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef __has_feature
+#define __has_feature(feature) 0
+#endif
+
+/**
+ * Counts heap allocations, so tests can check that the narrowphase never
+ * allocates. Sanitizer builds report allocations through the sanitizer hook
+ * API; other builds wrap glibc's malloc.
+ */
+size_t num_allocations = 0;
+
+#if __has_feature(address_sanitizer) || defined(__SANITIZE_ADDRESS__)
+int __sanitizer_install_malloc_and_free_hooks(
+    void (*malloc_hook)(const volatile void *, size_t),
+    void (*free_hook)(const volatile void *));
+
+void count_malloc(const volatile void *ptr, size_t size) { num_allocations++; }
+void ignore_free(const volatile void *ptr) {}
+
+void install_allocation_counter() {
+  __sanitizer_install_malloc_and_free_hooks(count_malloc, ignore_free);
+}
+#else
+void *__libc_malloc(size_t size);
+
+void *malloc(size_t size) {
+  num_allocations++;
+  return __libc_malloc(size);
+}
+
+void install_allocation_counter() {}
+#endif
+
+const size_t CIRCLE_POINTS = 100;
+
+list_t *make_circle(vector_t center, double radius) {
+  list_t *shape = list_init(CIRCLE_POINTS, free);
+  for (size_t i = 0; i < CIRCLE_POINTS; i++) {
+    double angle = 2 * M_PI * i / CIRCLE_POINTS;
+    vector_t *v = malloc(sizeof(*v));
+    *v = (vector_t){center.x + radius * cos(angle),
+                    center.y + radius * sin(angle)};
+    list_add(shape, v);
+  }
+  return shape;
+}
+
+list_t *make_rect(vector_t center, double width, double height) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {+1, -1}, {+1, +1}, {-1, +1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = (vector_t){center.x + corners[i].x * width / 2,
+                    center.y + corners[i].y * height / 2};
+    list_add(shape, v);
+  }
+  return shape;
+}
+
+list_t *make_triangle(vector_t center, double size) {
+  list_t *shape = list_init(3, free);
+  vector_t corners[] = {{-1, -1}, {+1, -1}, {0, +1}};
+  for (size_t i = 0; i < 3; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = (vector_t){center.x + corners[i].x * size,
+                    center.y + corners[i].y * size};
+    list_add(shape, v);
+  }
+  return shape;
+}
+
+body_t *make_body(list_t *shape) {
+  return body_init(shape, 1, (rgb_color_t){0, 0, 0});
+}
+
+void test_rect_collision() {
+  body_t *rect1 = make_body(make_rect((vector_t){0, 0}, 50, 80));
+  body_t *rect2 = make_body(make_rect((vector_t){45, 0}, 50, 80));
+  collision_info_t info = find_collision(rect1, rect2);
+  assert(info.collided);
+  assert(isclose(fabs(info.axis.x), 1) && isclose(info.axis.y, 0));
+
+  body_set_centroid(rect2, (vector_t){51, 0});
+  assert(!find_collision(rect1, rect2).collided);
+  assert(!find_collision(rect2, rect1).collided);
+
+  body_free(rect1);
+  body_free(rect2);
+}
+
+void test_circle_rect_collision() {
+  body_t *circle = make_body(make_circle((vector_t){0, 0}, 20));
+  body_t *rect = make_body(make_rect((vector_t){0, -25}, 100, 20));
+  collision_info_t info = find_collision(circle, rect);
+  assert(info.collided);
+  assert(within(1e-2, fabs(info.axis.y), 1));
+
+  body_set_centroid(rect, (vector_t){0, -41});
+  assert(!find_collision(circle, rect).collided);
+
+  body_free(circle);
+  body_free(rect);
+}
+
+void test_aabb_tracking() {
+  body_t *rect = make_body(make_rect((vector_t){0, 0}, 50, 80));
+  aabb_t aabb = body_get_aabb(rect);
+  assert(vec_isclose(aabb.min, (vector_t){-25, -40}));
+  assert(vec_isclose(aabb.max, (vector_t){25, 40}));
+
+  body_set_velocity(rect, (vector_t){10, 0});
+  body_tick(rect, 1);
+  aabb = body_get_aabb(rect);
+  assert(vec_isclose(aabb.min, (vector_t){-15, -40}));
+  assert(vec_isclose(aabb.max, (vector_t){35, 40}));
+
+  body_set_centroid(rect, (vector_t){100, 100});
+  body_set_rotation(rect, M_PI / 2);
+  aabb = body_get_aabb(rect);
+  assert(vec_isclose(aabb.min, (vector_t){60, 75}));
+  assert(vec_isclose(aabb.max, (vector_t){140, 125}));
+
+  aabb_t touching = {{140, 125}, {150, 130}};
+  aabb_t apart = {{141, 0}, {150, 130}};
+  assert(aabb_overlap(aabb, touching));
+  assert(!aabb_overlap(aabb, apart));
+
+  body_free(rect);
+}
+
+// A bird-vs-pig check must not touch the heap
+body_t *make_circle_body(vector_t center, double radius) {
+  return body_init_circle_with_info(center, radius, 1, (rgb_color_t){0, 0, 0},
+                                    NULL, NULL);
+}
+
+void test_native_circle_collision() {
+  body_t *a = make_circle_body((vector_t){0, 0}, 10);
+  body_t *b = make_circle_body((vector_t){15, 0}, 10);
+  body_t *c = make_circle_body((vector_t){0, 25}, 10);
+
+  collision_info_t collision = find_collision(a, b);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  collision = find_collision(b, a);
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+  assert(!find_collision(a, c).collided);
+
+  // near a corner the circle is only separated along the axis to the vertex
+  body_t *rect = make_body(make_rect((vector_t){0, 0}, 20, 20));
+  body_t *corner = make_circle_body((vector_t){16, 16}, 8);
+  assert(!find_collision(rect, corner).collided);
+  body_set_centroid(corner, (vector_t){14, 14});
+  collision = find_collision(rect, corner);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){M_SQRT1_2, M_SQRT1_2}));
+  collision = find_collision(corner, rect);
+  assert(vec_isclose(collision.axis, (vector_t){-M_SQRT1_2, -M_SQRT1_2}));
+
+  assert(isclose(body_get_mass(a), 1));
+  assert(within(1e-9, polygon_area(body_get_polygon(a)), M_PI * 100));
+  aabb_t aabb = body_get_aabb(c);
+  assert(vec_isclose(aabb.min, (vector_t){-10, 15}));
+  assert(vec_isclose(aabb.max, (vector_t){10, 35}));
+
+  body_free(a);
+  body_free(b);
+  body_free(c);
+  body_free(rect);
+  body_free(corner);
+}
+
+void test_cached_normals() {
+  body_t *rect = make_body(make_rect((vector_t){0, 0}, 40, 20));
+  polygon_t *poly = body_get_polygon(rect);
+  // opposite sides share an axis
+  assert(polygon_get_num_normals(poly) == 2);
+  const vector_t *normals = polygon_get_normals(poly);
+  assert(within(1e-9, fabs(normals[0].y), 1));
+  assert(within(1e-9, fabs(normals[1].x), 1));
+
+  body_set_rotation(rect, M_PI / 2);
+  normals = polygon_get_normals(poly);
+  assert(within(1e-9, fabs(normals[0].x), 1));
+  assert(within(1e-9, fabs(normals[1].y), 1));
+
+  // rotated a quarter turn, the rect is 20 wide and 40 tall
+  body_t *other = make_body(make_rect((vector_t){0, 22}, 10, 10));
+  collision_info_t collision = find_collision(rect, other);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0, 1}));
+  body_set_centroid(other, (vector_t){0, 26});
+  assert(!find_collision(rect, other).collided);
+
+  // a regular polygon with an even number of sides has parallel pairs
+  body_t *gon = make_body(make_circle((vector_t){0, 0}, 10));
+  assert(polygon_get_num_normals(body_get_polygon(gon)) == 50);
+
+  body_free(rect);
+  body_free(other);
+  body_free(gon);
+}
+
+void test_find_contacts() {
+  body_t *ground = make_body(make_rect((vector_t){0, 0}, 100, 20));
+  body_t *box = make_body(make_rect((vector_t){10, 18}, 20, 20));
+  collision_info_t collision = find_collision(ground, box);
+  contact_manifold_t contacts = find_contacts(ground, box, collision);
+  // a box resting on a face touches along its whole bottom edge
+  assert(contacts.num_points == 2);
+  assert(isclose(contacts.depth, 2));
+  assert(vec_isclose(contacts.normal, (vector_t){0, 1}));
+  for (size_t i = 0; i < 2; i++) {
+    assert(isclose(contacts.depths[i], 2));
+    assert(isclose(contacts.points[i].y, 9));
+  }
+  assert(isclose(fabs(contacts.points[0].x - contacts.points[1].x), 20));
+
+  // hanging off the end, the points are clipped to the ground's edge
+  body_set_centroid(box, (vector_t){45, 18});
+  contacts = find_contacts(ground, box, find_collision(ground, box));
+  assert(contacts.num_points == 2);
+  assert(isclose(fmax(contacts.points[0].x, contacts.points[1].x), 50));
+
+  body_t *ball = make_circle_body((vector_t){0, 25}, 20);
+  contacts = find_contacts(ground, ball, find_collision(ground, ball));
+  assert(contacts.num_points == 1);
+  assert(isclose(contacts.depth, 5));
+  assert(vec_isclose(contacts.points[0], (vector_t){0, 7.5}));
+  contacts = find_contacts(ball, ground, find_collision(ball, ground));
+  assert(vec_isclose(contacts.normal, (vector_t){0, -1}));
+  assert(vec_isclose(contacts.points[0], (vector_t){0, 7.5}));
+
+  body_set_centroid(ball, (vector_t){0, 40});
+  assert(find_contacts(ground, ball, find_collision(ground, ball))
+             .num_points == 0);
+
+  body_free(ground);
+  body_free(box);
+  body_free(ball);
+}
+
+const size_t NUM_GAME_BODIES = 60;
+const size_t BENCHMARK_ROUNDS = 200;
+
+// the shapes demo/game.c builds: birds, pigs and wood blocks
+body_t *make_game_body(size_t i) {
+  vector_t center = {rand() % 300, rand() % 300};
+  if (i % 3 == 0) {
+    return make_circle_body(center, 20);
+  }
+  if (i % 3 == 1) {
+    return make_circle_body(center, 25);
+  }
+  body_t *wood = make_body(make_rect(center, 50, 80));
+  // knocked-over blocks end up at any angle
+  if (i % 2 == 0) {
+    body_set_rotation(wood, 2 * M_PI * rand() / RAND_MAX);
+  }
+  return wood;
+}
+
+void test_gjk_matches_sat() {
+  body_t *bodies[NUM_GAME_BODIES];
+  for (size_t i = 0; i < NUM_GAME_BODIES; i++) {
+    bodies[i] = make_game_body(i);
+  }
+
+  size_t num_collisions = 0;
+  for (size_t i = 0; i < NUM_GAME_BODIES; i++) {
+    for (size_t j = i + 1; j < NUM_GAME_BODIES; j++) {
+      collision_info_t sat = find_collision(bodies[i], bodies[j]);
+      collision_info_t gjk = find_collision_gjk(bodies[i], bodies[j]);
+      assert(sat.collided == gjk.collided);
+      if (sat.collided) {
+        num_collisions++;
+        assert(within(1e-3, gjk.axis.x, sat.axis.x));
+        assert(within(1e-3, gjk.axis.y, sat.axis.y));
+      }
+      collision_info_t chosen =
+          find_collision_with(NARROWPHASE_GJK, bodies[i], bodies[j]);
+      assert(chosen.collided == gjk.collided);
+    }
+  }
+  assert(num_collisions > 0);
+
+  // time both on every pair, most of which the boxes reject
+  clock_t start = clock();
+  size_t hits = 0;
+  for (size_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM_GAME_BODIES; i++) {
+      for (size_t j = i + 1; j < NUM_GAME_BODIES; j++) {
+        hits += find_collision(bodies[i], bodies[j]).collided;
+      }
+    }
+  }
+  double sat_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (size_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM_GAME_BODIES; i++) {
+      for (size_t j = i + 1; j < NUM_GAME_BODIES; j++) {
+        hits -= find_collision_gjk(bodies[i], bodies[j]).collided;
+      }
+    }
+  }
+  double gjk_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+  assert(hits == 0);
+  printf("narrowphase on game shapes: sat %.3fs, gjk %.3fs\n", sat_time,
+         gjk_time);
+
+  for (size_t i = 0; i < NUM_GAME_BODIES; i++) {
+    body_free(bodies[i]);
+  }
+}
+
+// launches a body at a speed that carries it 200 units in one tick
+body_t *launch(body_t *body) {
+  body_set_bullet(body, true);
+  body_set_velocity(body, (vector_t){1000, 0});
+  body_tick(body, 0.2);
+  return body;
+}
+
+void test_time_of_impact() {
+  body_t *wall = make_body(make_rect((vector_t){100, 0}, 1, 200));
+  double time;
+
+  body_t *ball = launch(make_circle_body((vector_t){0, 0}, 10));
+  assert(vec_isclose(body_get_centroid(ball), (vector_t){200, 0}));
+  assert(!find_collision(ball, wall).collided);
+  // the bullet's box covers the path it took
+  assert(aabb_overlap(body_get_aabb(ball), body_get_aabb(wall)));
+  collision_info_t collision = find_time_of_impact(ball, wall, &time);
+  assert(collision.collided);
+  assert(isclose(time, 89.5 / 200));
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  collision = find_time_of_impact(wall, ball, &time);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+
+  body_rewind(ball, time);
+  assert(vec_isclose(body_get_centroid(ball), (vector_t){89.5, 0}));
+  assert(find_collision(ball, wall).collided);
+  // already overlapping at the start of the tick
+  body_set_centroid(ball, (vector_t){95, 0});
+  body_tick(ball, 0.2);
+  assert(!find_time_of_impact(ball, wall, &time).collided);
+  body_free(ball);
+
+  // clips the wall's corner
+  ball = launch(make_circle_body((vector_t){0, 105}, 10));
+  collision = find_time_of_impact(ball, wall, &time);
+  assert(collision.collided);
+  assert(within(1e-9, time, (99.5 - sqrt(75)) / 200));
+  assert(vec_isclose(collision.axis, (vector_t){sqrt(75) / 10, -0.5}));
+  body_free(ball);
+
+  ball = launch(make_circle_body((vector_t){0, 111}, 10));
+  assert(!find_time_of_impact(ball, wall, &time).collided);
+  body_free(ball);
+
+  body_t *box = launch(make_body(make_rect((vector_t){0, 0}, 10, 10)));
+  collision = find_time_of_impact(box, wall, &time);
+  assert(collision.collided);
+  assert(isclose(time, 94.5 / 200));
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  body_free(box);
+
+  body_t *target = make_circle_body((vector_t){100, 0}, 10);
+  ball = launch(make_circle_body((vector_t){0, 0}, 10));
+  collision = find_time_of_impact(ball, target, &time);
+  assert(collision.collided);
+  assert(isclose(time, 0.4));
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  body_free(ball);
+  body_free(target);
+
+  body_free(wall);
+}
+
+void test_collision_no_allocations() {
+  body_t *bird = make_body(make_circle((vector_t){0, 0}, 20));
+  body_t *pig = make_body(make_circle((vector_t){30, 0}, 25));
+  body_t *wood = make_body(make_rect((vector_t){200, 0}, 50, 80));
+  body_t *ball = make_circle_body((vector_t){0, 39}, 20);
+  body_t *left = make_body(make_triangle((vector_t){100, 100}, 10));
+  body_t *right = make_body(make_triangle((vector_t){115, 100}, 10));
+  pair_t pairs[] = {{left, right}, {left, ball}};
+  collision_info_t results[2];
+
+  size_t allocations = num_allocations;
+  assert(find_collision(bird, pig).collided);
+  assert(!find_collision(bird, wood).collided);
+  assert(!find_collision(wood, pig).collided);
+  assert(find_collision(ball, bird).collided);
+  assert(!find_collision(ball, wood).collided);
+  assert(find_collision_gjk(bird, pig).collided);
+  assert(!find_collision_gjk(bird, wood).collided);
+  assert(find_collision_gjk(ball, bird).collided);
+  assert(find_collision(left, right).collided);
+  find_collisions_batch(pairs, 2, results);
+  assert(results[0].collided && !results[1].collided);
+  assert(num_allocations == allocations);
+
+  body_free(bird);
+  body_free(pig);
+  body_free(wood);
+  body_free(ball);
+  body_free(left);
+  body_free(right);
+}
+
+// Tests point and segment queries against single bodies
+void test_ray_hit() {
+  body_t *rect = make_body(make_rect((vector_t){10, 0}, 4, 6));
+  body_t *ball = make_circle_body((vector_t){0, 10}, 2);
+
+  assert(point_in_body(rect, (vector_t){11, 2}));
+  assert(point_in_body(rect, (vector_t){12, 3}));
+  assert(!point_in_body(rect, (vector_t){12.1, 0}));
+  assert(point_in_body(ball, (vector_t){1, 11}));
+  assert(!point_in_body(ball, (vector_t){1.5, 11.5}));
+
+  ray_hit_t hit;
+  size_t allocations = num_allocations;
+  assert(find_ray_hit(rect, (vector_t){0, 1}, (vector_t){20, 1}, &hit));
+  assert(num_allocations == allocations);
+  assert(hit.body == rect);
+  assert(isclose(hit.fraction, 0.4));
+  assert(vec_isclose(hit.point, (vector_t){8, 1}));
+  assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+  // from above, through the top edge
+  assert(find_ray_hit(rect, (vector_t){11, 10}, (vector_t){11, -10}, &hit));
+  assert(vec_isclose(hit.point, (vector_t){11, 3}));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+  // too short, passing by, and starting inside
+  assert(!find_ray_hit(rect, (vector_t){0, 1}, (vector_t){7, 1}, &hit));
+  assert(!find_ray_hit(rect, (vector_t){0, 4}, (vector_t){20, 4}, &hit));
+  assert(!find_ray_hit(rect, (vector_t){10, 0}, (vector_t){20, 0}, &hit));
+
+  assert(find_ray_hit(ball, (vector_t){0, 0}, (vector_t){0, 20}, &hit));
+  assert(isclose(hit.fraction, 0.4));
+  assert(vec_isclose(hit.normal, (vector_t){0, -1}));
+  assert(!find_ray_hit(ball, (vector_t){3, 0}, (vector_t){3, 20}, &hit));
+
+  body_free(rect);
+  body_free(ball);
+}
+
+// Tests that detailed shapes collide as simpler proxies that follow them
+void test_collision_proxy() {
+  // a 100-gon collides as a true circle, but is still drawn with 100 points
+  body_t *gon = make_body(make_circle((vector_t){0, 0}, 10));
+  assert(body_get_shape_type(gon) == SHAPE_CIRCLE);
+  assert(within(1e-2, body_get_radius(gon), 10));
+  assert(polygon_get_num_vertices(body_get_polygon(gon)) == 100);
+  body_set_velocity(gon, (vector_t){10, 0});
+  body_tick(gon, 1);
+  assert(vec_isclose(polygon_get_center(body_get_collision_polygon(gon)),
+                     body_get_centroid(gon)));
+  assert(within(1e-2, body_get_aabb(gon).max.x, 20));
+
+  // unless it must be exact
+  body_set_collision_tolerance(gon, 0);
+  assert(body_get_collision_polygon(gon) == body_get_polygon(gon));
+  assert(body_get_shape_type(gon) == SHAPE_POLYGON);
+
+  // a box with a slightly bulging side collides as a box
+  list_t *shape = list_init(13, free);
+  for (size_t i = 0; i < 13; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    if (i < 2 || i == 12) {
+      *v = (vector_t){i == 1 ? 50 : -50, i == 12 ? 10 : -10};
+    } else {
+      // the top edge from (50, 10) to (-40, 10.1)
+      *v = (vector_t){50 - 10.0 * (i - 2), i == 2 ? 10 : 10.1};
+    }
+    list_add(shape, v);
+  }
+  body_t *box = make_body(shape);
+  body_set_collision_tolerance(box, 0.5);
+  polygon_t *proxy = body_get_collision_polygon(box);
+  assert(polygon_get_num_vertices(proxy) == 4);
+  assert(polygon_get_num_vertices(body_get_polygon(box)) == 13);
+
+  body_set_centroid(box, (vector_t){100, 100});
+  body_set_rotation(box, M_PI / 2);
+  aabb_t aabb = body_get_aabb(box);
+  assert(within(1e-1, aabb.min.x, 90) && within(1e-1, aabb.max.x, 110));
+  assert(within(1e-1, aabb.min.y, 50) && within(1e-1, aabb.max.y, 150));
+  body_t *ball = make_circle_body((vector_t){100, 160}, 5);
+  assert(!find_collision(box, ball).collided);
+  body_set_centroid(ball, (vector_t){100, 154});
+  assert(find_collision(box, ball).collided);
+
+  body_free(gon);
+  body_free(box);
+  body_free(ball);
+}
+
+// Tests half-plane and segment bodies against circles and polygons
+void test_half_planes_and_segments() {
+  rgb_color_t black = {0, 0, 0};
+  body_t *ground = body_init_half_plane_with_info(
+      (vector_t){0, 0}, (vector_t){0, 2}, INFINITY, black, NULL, NULL);
+  assert(body_get_shape_type(ground) == SHAPE_HALF_PLANE);
+  assert(body_get_aabb(ground).max.y == 0);
+  assert(body_get_aabb(ground).min.x == -__DBL_MAX__);
+
+  body_t *ball = make_circle_body((vector_t){1000, 9}, 10);
+  collision_info_t collision = find_collision(ground, ball);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0, 1}));
+  assert(vec_isclose(find_collision(ball, ground).axis, (vector_t){0, -1}));
+  assert(find_collision_gjk(ball, ground).collided);
+  contact_manifold_t contacts = find_contacts(ground, ball, collision);
+  assert(contacts.num_points == 1 && isclose(contacts.depth, 1));
+  assert(vec_isclose(contacts.points[0], (vector_t){1000, -0.5}));
+  body_set_centroid(ball, (vector_t){1000, 11});
+  assert(!find_collision(ground, ball).collided);
+
+  body_t *box = make_body(make_rect((vector_t){5000, 4}, 10, 10));
+  collision = find_collision(box, ground);
+  assert(collision.collided);
+  contacts = find_contacts(box, ground, collision);
+  assert(contacts.num_points == 2 && isclose(contacts.depth, 1));
+  assert(isclose(contacts.points[1].y, -0.5));
+
+  // however fast a bullet goes, it can't get past the boundary
+  body_set_bullet(ball, true);
+  body_set_centroid(ball, (vector_t){0, 100});
+  body_set_velocity(ball, (vector_t){0, -1000});
+  body_tick(ball, 0.2);
+  assert(find_collision(ball, ground).collided);
+  double time;
+  collision = find_time_of_impact(ball, ground, &time);
+  assert(collision.collided && isclose(time, 0.45));
+  assert(vec_isclose(collision.axis, (vector_t){0, -1}));
+
+  assert(point_in_body(ground, (vector_t){3, -1}));
+  assert(!point_in_body(ground, (vector_t){3, 1}));
+  ray_hit_t hit;
+  assert(find_ray_hit(ground, (vector_t){0, 10}, (vector_t){0, -10}, &hit));
+  assert(isclose(hit.fraction, 0.5));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+  assert(!find_ray_hit(ground, (vector_t){0, -1}, (vector_t){0, -10}, &hit));
+
+  // a slanted half-plane is only bounded on its normal
+  body_t *slope = body_init_half_plane_with_info(
+      (vector_t){0, 0}, (vector_t){1, 1}, INFINITY, black, NULL, NULL);
+  body_t *crate = make_body(make_rect((vector_t){3, 3}, 2, 2));
+  separating_axis_t cache = {false, VEC_ZERO};
+  axis_cache_stats_t stats = {0, 0};
+  find_collision_cached(NARROWPHASE_SAT, slope, crate, &cache, &stats);
+  assert(!find_collision_cached(NARROWPHASE_SAT, slope, crate, &cache, &stats)
+              .collided);
+  assert(stats.hits == 1);
+  body_set_centroid(crate, (vector_t){1, 1});
+  assert(find_collision(slope, crate).collided);
+  // half-planes never collide with each other
+  assert(!find_collision(slope, ground).collided);
+
+  // a segment ends, so shapes lined up past its ends miss it
+  body_t *ledge = body_init_segment_with_info(
+      (vector_t){0, 0}, (vector_t){10, 0}, INFINITY, black, NULL, NULL);
+  assert(vec_isclose(body_get_centroid(ledge), (vector_t){5, 0}));
+  body_set_centroid(ball, (vector_t){5, 1});
+  assert(find_collision(ledge, ball).collided);
+  body_set_centroid(box, (vector_t){16, 0});
+  assert(!find_collision(ledge, box).collided);
+  assert(!find_collision_gjk(ledge, box).collided);
+  body_set_centroid(box, (vector_t){5, 4.5});
+  collision = find_collision(ledge, box);
+  assert(collision.collided);
+  contacts = find_contacts(ledge, box, collision);
+  assert(contacts.num_points == 2 && isclose(contacts.depth, 0.5));
+  assert(point_in_body(ledge, (vector_t){3, 0}));
+  assert(!point_in_body(ledge, (vector_t){11, 0}));
+  assert(find_ray_hit(ledge, (vector_t){5, 5}, (vector_t){5, -5}, &hit));
+  assert(isclose(hit.fraction, 0.5));
+  assert(!find_ray_hit(ledge, (vector_t){12, 5}, (vector_t){12, -5}, &hit));
+
+  body_free(ground);
+  body_free(ball);
+  body_free(box);
+  body_free(slope);
+  body_free(crate);
+  body_free(ledge);
+}
+
+// the same rectangle as make_rect(), but with an extra vertex partway along
+// its bottom edge, so it isn't read as a box. The vertex sticks out by a
+// hair so it isn't simplified away either.
+list_t *make_split_rect(vector_t center, double width, double height) {
+  list_t *shape = make_rect(center, width, height);
+  list_t *split = list_init(5, free);
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = list_get(shape, i);
+    vector_t *copy = malloc(sizeof(*copy));
+    *copy = *v;
+    list_add(split, copy);
+    if (i == 0) {
+      vector_t *mid = malloc(sizeof(*mid));
+      vector_t *next = list_get(shape, 1);
+      *mid = vec_add(*v, vec_multiply(0.3, vec_subtract(*next, *v)));
+      mid->y -= 1e-12;
+      list_add(split, mid);
+    }
+  }
+  list_free(shape);
+  return split;
+}
+
+double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// Tests that the oriented-box kernels agree with the generic ones
+void test_box_kernels() {
+  body_t *box = make_body(make_rect((vector_t){0, 0}, 50, 80));
+  body_t *split = make_body(make_split_rect((vector_t){0, 0}, 50, 80));
+  body_set_collision_tolerance(split, 0);
+  assert(polygon_is_box(body_get_collision_polygon(box)));
+  assert(!polygon_is_box(body_get_collision_polygon(split)));
+  assert(vec_isclose(polygon_get_half_extents(body_get_polygon(box)),
+                     (vector_t){40, 25}));
+
+  list_t *parallelogram = make_rect((vector_t){0, 0}, 10, 10);
+  ((vector_t *)list_get(parallelogram, 2))->x += 5;
+  ((vector_t *)list_get(parallelogram, 3))->x += 5;
+  body_t *skewed = make_body(parallelogram);
+  assert(!polygon_is_box(body_get_polygon(skewed)));
+  body_free(skewed);
+
+  body_t *other_box = make_body(make_rect((vector_t){0, 0}, 30, 20));
+  body_t *other_split = make_body(make_split_rect((vector_t){0, 0}, 30, 20));
+  body_set_collision_tolerance(other_split, 0);
+  body_t *ball = make_circle_body((vector_t){0, 0}, 15);
+  size_t hits = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    double angle = random_between(0, 2 * M_PI);
+    body_set_rotation(box, angle);
+    body_set_rotation(split, angle);
+    angle = random_between(0, 2 * M_PI);
+    body_set_rotation(other_box, angle);
+    body_set_rotation(other_split, angle);
+    vector_t position = {random_between(-80, 80), random_between(-80, 80)};
+    body_set_centroid(other_box, position);
+    body_set_centroid(other_split, position);
+    body_set_centroid(ball, position);
+
+    collision_info_t expected = find_collision(split, other_split);
+    collision_info_t actual = find_collision(box, other_box);
+    assert(actual.collided == expected.collided);
+    assert(vec_within(1e-9, actual.axis, expected.axis));
+    hits += actual.collided;
+
+    expected = find_collision(ball, split);
+    actual = find_collision(ball, box);
+    assert(actual.collided == expected.collided);
+    assert(vec_within(1e-9, actual.axis, expected.axis));
+  }
+  // both ways happen often
+  assert(hits > 200 && hits < 1800);
+
+  body_free(box);
+  body_free(split);
+  body_free(other_box);
+  body_free(other_split);
+  body_free(ball);
+}
+
+// Tests that the batched narrowphase matches find_collision() pair by pair,
+// across several chunks and every kind of shape
+void test_collisions_batch() {
+  const size_t num_bodies = 24;
+  body_t *bodies[num_bodies];
+  for (size_t i = 0; i < num_bodies; i++) {
+    vector_t center = {random_between(0, 100), random_between(0, 100)};
+    switch (i % 4) {
+    case 0:
+      bodies[i] = make_circle_body(center, random_between(5, 20));
+      break;
+    case 1:
+      bodies[i] = make_body(make_rect(center, random_between(5, 40), 10));
+      body_set_rotation(bodies[i], random_between(0, M_PI));
+      break;
+    case 2:
+      bodies[i] = make_body(make_circle(center, random_between(5, 20)));
+      body_set_collision_tolerance(bodies[i], 0);
+      break;
+    default:
+      bodies[i] = body_init_segment_with_info(
+          center, (vector_t){center.x + 30, center.y + 5}, 1,
+          (rgb_color_t){0, 0, 0}, NULL, NULL);
+    }
+  }
+  body_free(bodies[num_bodies - 1]);
+  bodies[num_bodies - 1] = body_init_half_plane_with_info(
+      (vector_t){0, 20}, (vector_t){0, 1}, 1, (rgb_color_t){0, 0, 0}, NULL,
+      NULL);
+
+  const size_t num_pairs = num_bodies * (num_bodies - 1) / 2;
+  pair_t pairs[num_pairs];
+  collision_info_t results[num_pairs];
+  size_t k = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    for (size_t j = i + 1; j < num_bodies; j++) {
+      pairs[k++] = (pair_t){bodies[i], bodies[j]};
+    }
+  }
+
+  size_t allocations = num_allocations;
+  find_collisions_batch(pairs, num_pairs, results);
+  assert(num_allocations == allocations);
+  size_t hits = 0;
+  for (size_t i = 0; i < num_pairs; i++) {
+    collision_info_t expected = find_collision(pairs[i].body1, pairs[i].body2);
+    assert(results[i].collided == expected.collided);
+    assert(vec_equal(results[i].axis, expected.axis));
+    hits += expected.collided;
+  }
+  assert(hits > 0 && hits < num_pairs);
+  // an empty batch does nothing
+  find_collisions_batch(pairs, 0, results);
+
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_free(bodies[i]);
+  }
+}
+
+// Tests that a body's area and moment of inertia are found once and kept
+void test_mass_properties() {
+  body_t *rect = body_init(make_rect((vector_t){30, 40}, 6, 4), 2,
+                           (rgb_color_t){0, 0, 0});
+  body_t *ball = make_circle_body((vector_t){0, 0}, 3);
+  body_t *stick = body_init_segment_with_info(
+      (vector_t){0, 0}, (vector_t){6, 8}, 3, (rgb_color_t){0, 0, 0}, NULL,
+      NULL);
+  body_t *block = body_init(make_rect((vector_t){0, 0}, 1, 1), INFINITY,
+                            (rgb_color_t){0, 0, 0});
+
+  for (size_t i = 0; i < 3; i++) {
+    assert(isclose(body_get_area(rect), 24));
+    assert(isclose(body_get_moment_of_inertia(rect), 2 * (36.0 + 16) / 12));
+    assert(isclose(body_get_area(ball), M_PI * 9));
+    assert(isclose(body_get_moment_of_inertia(ball), 9.0 / 2));
+    assert(body_get_area(stick) == 0);
+    assert(isclose(body_get_moment_of_inertia(stick), 3 * 100.0 / 12));
+
+    body_add_impulse(rect, (vector_t){5, -7});
+    body_tick(rect, 1);
+    body_set_rotation(rect, i + 1);
+    body_set_centroid(ball, (vector_t){i, 2 * i});
+  }
+  assert(body_get_moment_of_inertia(block) == INFINITY);
+
+  body_free(rect);
+  body_free(ball);
+  body_free(stick);
+  body_free(block);
+}
+
+// Tests that bodies made from a prototype match bodies made from scratch
+void test_shared_shapes() {
+  rgb_color_t black = {0, 0, 0};
+  body_t *prototype = make_body(make_rect((vector_t){100, 100}, 20, 10));
+  body_set_rotation(prototype, 0.7);
+  body_t *gon_prototype = make_body(make_circle((vector_t){50, 50}, 10));
+
+  body_t *block = body_init_instance_with_info(prototype, (vector_t){0, 0},
+                                               2, black, NULL, NULL);
+  body_t *fresh = body_init(make_rect((vector_t){0, 0}, 20, 10), 2, black);
+  body_t *gon = body_init_instance_with_info(
+      gon_prototype, (vector_t){-30, 0}, 1, black, NULL, NULL);
+  // the prototypes aren't needed once their instances are made
+  body_free(prototype);
+  body_free(gon_prototype);
+
+  body_t *ball = make_circle_body((vector_t){12, 3}, 4);
+  for (size_t i = 0; i < 3; i++) {
+    polygon_t *poly = body_get_polygon(block);
+    const vector_t *vertices = polygon_get_vertices(poly);
+    const vector_t *expected = polygon_get_vertices(body_get_polygon(fresh));
+    assert(polygon_get_num_vertices(poly) == 4);
+    for (size_t j = 0; j < 4; j++) {
+      assert(vec_isclose(vertices[j], expected[j]));
+    }
+    assert(vec_isclose(body_get_aabb(block).min, body_get_aabb(fresh).min));
+    assert(vec_isclose(body_get_aabb(block).max, body_get_aabb(fresh).max));
+    assert(isclose(body_get_moment_of_inertia(block),
+                   body_get_moment_of_inertia(fresh)));
+    collision_info_t expected_hit = find_collision(fresh, ball);
+    collision_info_t hit = find_collision(block, ball);
+    assert(hit.collided == expected_hit.collided);
+    assert(vec_isclose(hit.axis, expected_hit.axis));
+
+    body_set_centroid(block, (vector_t){i, -2.0 * i});
+    body_set_centroid(fresh, (vector_t){i, -2.0 * i});
+    body_set_rotation(block, i + 0.5);
+    body_set_rotation(fresh, i + 0.5);
+  }
+
+  // the simpler shape the prototype collided as is shared too
+  assert(body_get_shape_type(gon) == SHAPE_CIRCLE);
+  assert(within(1e-2, body_get_radius(gon), 10));
+  assert(vec_isclose(polygon_get_center(body_get_collision_polygon(gon)),
+                     (vector_t){-30, 0}));
+  assert(polygon_get_num_vertices(body_get_polygon(gon)) == 100);
+
+  body_free(block);
+  body_free(fresh);
+  body_free(gon);
+  body_free(ball);
+}
+
+// Tests that a body's vertices can be read in place, without allocating
+void test_vertex_span() {
+  body_t *wood = make_body(make_rect((vector_t){0, 0}, 50, 80));
+  body_t *ball = make_circle_body((vector_t){0, 0}, 20);
+  body_set_centroid(wood, (vector_t){10, 20});
+  body_set_rotation(wood, 0.3);
+
+  list_t *shape = body_get_shape(wood);
+  size_t allocations = num_allocations;
+  vertex_span_t span = body_get_vertices(wood);
+  assert(span.num_vertices == list_size(shape));
+  for (size_t i = 0; i < span.num_vertices; i++) {
+    assert(vec_equal(span.vertices[i], *(vector_t *)list_get(shape, i)));
+  }
+  assert(body_get_vertices(ball).num_vertices == 0);
+  assert(num_allocations == allocations);
+  list_free(shape);
+
+  body_free(wood);
+  body_free(ball);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+  install_allocation_counter();
+
+  DO_TEST(test_rect_collision)
+  DO_TEST(test_circle_rect_collision)
+  DO_TEST(test_aabb_tracking)
+  DO_TEST(test_native_circle_collision)
+  DO_TEST(test_cached_normals)
+  DO_TEST(test_find_contacts)
+  DO_TEST(test_gjk_matches_sat)
+  DO_TEST(test_time_of_impact)
+  DO_TEST(test_collision_no_allocations)
+  DO_TEST(test_ray_hit)
+  DO_TEST(test_collision_proxy)
+  DO_TEST(test_half_planes_and_segments)
+  DO_TEST(test_box_kernels)
+  DO_TEST(test_collisions_batch)
+  DO_TEST(test_mass_properties)
+  DO_TEST(test_shared_shapes)
+  DO_TEST(test_vertex_span)
+
+  puts("collision_test PASS");
+}
@@ -91,6 +91,14 @@ body_t *make_triangle_body() {
   return body_init(shape, 1, (rgb_color_t){0, 0, 0});
 }
 
+// Makes a box whose info is its id, for handlers to log
+body_t *make_tagged_body(size_t id) {
+  size_t *info = malloc(sizeof(*info));
+  *info = id;
+  return body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0}, info,
+                             free);
+}
+
 // Tests that destructive collisions remove bodies from the scene
 void test_collisions() {
   const double DT = 0.1;
@@ -130,6 +138,343 @@ void test_collisions() {
   scene_free(scene);
 }
 
+// Tests that a box pulled onto the ground comes to rest on it
+void test_resting_contact() {
+  const double DT = 0.01;
+  scene_t *scene = scene_init();
+  body_t *ground = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, ground);
+  body_t *box = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(box, (vector_t){0, 2.5});
+  scene_add_body(scene, box);
+  // like the game, gravity pulls towards a heavy body far below
+  body_t *earth = body_init(make_shape(), 1e12, (rgb_color_t){0, 0, 0});
+  body_set_centroid(earth, (vector_t){0, -1e4});
+  scene_add_body(scene, earth);
+  create_newtonian_gravity(scene, 1e-2, box, earth);
+  create_physics_collision(scene, ground, box, 0.5);
+
+  for (int i = 0; i < 1000; i++) {
+    scene_tick(scene, DT);
+    // never falls through, even though it is pulled down every tick
+    assert(body_get_centroid(box).y > 1);
+  }
+  // settled: barely moving, and only sunk in a little
+  double height = body_get_centroid(box).y;
+  for (int i = 0; i < 100; i++) {
+    scene_tick(scene, DT);
+    assert(within(1e-3, body_get_centroid(box).y, height));
+  }
+  assert(height > 1.9 && height < 2);
+  assert(fabs(body_get_velocity(box).y) < 1e-2);
+  scene_free(scene);
+}
+
+// Tests that a stack of boxes dropped onto the ground holds itself up and
+// comes to rest, each box held up by the ones below it
+void test_stacked_contacts() {
+  const double DT = 0.01;
+  const size_t NUM_BOXES = 6;
+  scene_t *scene = scene_init();
+  body_t *ground = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, ground);
+  body_t *earth = body_init(make_shape(), 1e12, (rgb_color_t){0, 0, 0});
+  body_set_centroid(earth, (vector_t){0, -1e4});
+  scene_add_body(scene, earth);
+  body_t *boxes[NUM_BOXES];
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    boxes[i] = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(boxes[i], (vector_t){0, 2.1 * (i + 1)});
+    scene_add_body(scene, boxes[i]);
+    create_newtonian_gravity(scene, 1e-2, boxes[i], earth);
+    create_physics_collision(scene, ground, boxes[i], 0.5);
+    for (size_t j = 0; j < i; j++) {
+      create_physics_collision(scene, boxes[j], boxes[i], 0.5);
+    }
+  }
+
+  for (int i = 0; i < 1000; i++) {
+    scene_tick(scene, DT);
+  }
+  double heights[NUM_BOXES];
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    heights[i] = body_get_centroid(boxes[i]).y;
+  }
+  for (int i = 0; i < 100; i++) {
+    scene_tick(scene, DT);
+    for (size_t j = 0; j < NUM_BOXES; j++) {
+      assert(within(1e-3, body_get_centroid(boxes[j]).y, heights[j]));
+      assert(fabs(body_get_velocity(boxes[j]).y) < 1e-2);
+    }
+  }
+  // each box only sinks a little into the one below it
+  double below = 0;
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    assert(heights[i] - below > 1.5 && heights[i] - below < 2);
+    below = heights[i];
+  }
+  scene_free(scene);
+}
+
+typedef struct {
+  size_t count;
+  body_t *first;
+  vector_t axis;
+} handler_calls_t;
+
+void count_handler_calls(body_t *body1, body_t *body2, vector_t axis,
+                         void *aux, double force_const) {
+  handler_calls_t *calls = aux;
+  calls->count++;
+  calls->first = body1;
+  calls->axis = axis;
+}
+
+// Tests that layer handlers run once per contact, in the registered order,
+// and only for bodies whose masks let them collide
+void test_layer_handlers() {
+  scene_t *scene = scene_init();
+  body_t *body1 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_layer(body1, 1);
+  body_set_centroid(body1, (vector_t){-1.5, 0});
+  scene_add_body(scene, body1);
+  body_t *body2 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_layer(body2, 2);
+  scene_add_body(scene, body2);
+  // overlaps body2 too, but doesn't collide with its layer
+  body_t *body3 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_layer(body3, 1);
+  body_set_mask(body3, 1 << 1);
+  body_set_centroid(body3, (vector_t){1.5, 0});
+  scene_add_body(scene, body3);
+  assert(!body_layers_collide(body2, body3));
+
+  handler_calls_t calls = {0, NULL, VEC_ZERO};
+  scene_set_layer_handler(scene, 2, 1, count_handler_calls, &calls, 0);
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(calls.count == 1);
+  assert(calls.first == body2);
+  assert(vec_isclose(calls.axis, (vector_t){-1, 0}));
+
+  // separating and touching again is a new contact
+  body_set_centroid(body1, (vector_t){-10, 0});
+  scene_tick(scene, 0.01);
+  body_set_centroid(body1, (vector_t){-1.5, 0});
+  scene_tick(scene, 0.01);
+  assert(calls.count == 2);
+
+  scene_set_layer_handler(scene, 1, 2, NULL, NULL, 0);
+  body_set_centroid(body1, (vector_t){-10, 0});
+  scene_tick(scene, 0.01);
+  body_set_centroid(body1, (vector_t){-1.5, 0});
+  scene_tick(scene, 0.01);
+  assert(calls.count == 2);
+  scene_free(scene);
+}
+
+typedef struct {
+  size_t num_calls;
+  size_t calls[1000];
+} call_log_t;
+
+void log_handler_call(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                      double force_const) {
+  call_log_t *log = aux;
+  if (log->num_calls < 1000) {
+    size_t id1 = *(size_t *)body_get_info(body1);
+    size_t id2 = *(size_t *)body_get_info(body2);
+    log->calls[log->num_calls++] = id1 * 100 + id2;
+  }
+}
+
+// Runs a scene of boxes flying through each other and logs its handler calls
+void log_layer_collisions(size_t num_threads, call_log_t *log) {
+  srand(3);
+  scene_t *scene = scene_init();
+  scene_set_num_threads(scene, num_threads);
+  for (size_t i = 0; i < 60; i++) {
+    body_t *body = make_tagged_body(i);
+    body_set_layer(body, i % 3);
+    body_set_centroid(body, (vector_t){rand() % 50, rand() % 50});
+    body_set_velocity(body, (vector_t){rand() % 21 - 10, rand() % 21 - 10});
+    scene_add_body(scene, body);
+  }
+  log->num_calls = 0;
+  scene_set_layer_handler(scene, 0, 1, log_handler_call, log, 0);
+  scene_set_layer_handler(scene, 2, 1, log_handler_call, log, 0);
+  for (int i = 0; i < 100; i++) {
+    scene_tick(scene, 0.05);
+  }
+  scene_free(scene);
+}
+
+// Tests that splitting the narrowphase between threads doesn't change which
+// handlers run, or their order
+void test_threaded_layer_handlers() {
+  call_log_t *expected = malloc(sizeof(call_log_t));
+  call_log_t *actual = malloc(sizeof(call_log_t));
+  log_layer_collisions(1, expected);
+  assert(expected->num_calls > 10);
+  for (size_t num_threads = 2; num_threads <= 8; num_threads *= 2) {
+    log_layer_collisions(num_threads, actual);
+    assert(actual->num_calls == expected->num_calls);
+    for (size_t i = 0; i < expected->num_calls; i++) {
+      assert(actual->calls[i] == expected->calls[i]);
+    }
+  }
+  free(expected);
+  free(actual);
+}
+
+void log_other_handler_call(body_t *body1, body_t *body2, vector_t axis,
+                            void *aux, double force_const) {
+  log_handler_call(body1, body2, axis, aux, force_const);
+  call_log_t *log = aux;
+  log->calls[log->num_calls - 1] += 10000;
+}
+
+// Tests that collisions are queued as events during the tick, then handled
+// in one batch grouped by handler
+void test_collision_events() {
+  scene_t *scene = scene_init();
+  size_t layers[] = {1, 3, 2, 1};
+  double xs[] = {0, 1.5, -1.5, -3};
+  for (size_t i = 0; i < 4; i++) {
+    body_t *body = make_tagged_body(i);
+    body_set_layer(body, layers[i]);
+    body_set_centroid(body, (vector_t){xs[i], 0});
+    scene_add_body(scene, body);
+  }
+  body_set_velocity(scene_get_body(scene, 1), (vector_t){-2, 1});
+
+  call_log_t *log = malloc(sizeof(call_log_t));
+  log->num_calls = 0;
+  scene_set_layer_handler(scene, 1, 2, log_handler_call, log, 0);
+  scene_set_layer_handler(scene, 1, 3, log_other_handler_call, log, 0);
+  scene_tick(scene, 0);
+
+  // pairs are found as (0, 1), (0, 2), (2, 3), but handled by handler
+  assert(log->num_calls == 3);
+  assert(log->calls[0] == 10001);
+  assert(log->calls[1] == 2);
+  assert(log->calls[2] == 302);
+
+  assert(scene_num_collision_events(scene) == 3);
+  collision_event_t event = scene_get_collision_event(scene, 0);
+  assert(event.body1 == scene_get_body(scene, 0));
+  assert(event.body2 == scene_get_body(scene, 1));
+  assert(vec_isclose(event.axis, (vector_t){1, 0}));
+  assert(isclose(event.depth, 0.5));
+  assert(vec_isclose(event.relative_velocity, (vector_t){-2, 1}));
+
+  // still touching, so nothing new
+  scene_tick(scene, 0);
+  assert(scene_num_collision_events(scene) == 0);
+  assert(log->num_calls == 3);
+  free(log);
+  scene_free(scene);
+}
+
+typedef struct {
+  call_log_t *log;
+  size_t group;
+} group_aux_t;
+
+void log_group_call(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                    double force_const) {
+  group_aux_t *group = aux;
+  log_handler_call(body1, body2, axis, group->log, force_const);
+  group->log->calls[group->log->num_calls - 1] += group->group * 10000;
+}
+
+// Tests that events from many different handlers are still handled grouped
+// by handler, in the order each handler's first event was queued
+void test_many_event_groups() {
+  const size_t NUM_BODIES = 12;
+  const size_t NUM_GROUPS = 20;
+  scene_t *scene = scene_init();
+  call_log_t *log = malloc(sizeof(call_log_t));
+  log->num_calls = 0;
+  group_aux_t groups[NUM_GROUPS];
+  for (size_t k = 0; k < NUM_GROUPS; k++) {
+    groups[k] = (group_aux_t){log, k};
+  }
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    scene_add_body(scene, make_tagged_body(i));
+    for (size_t j = 0; j < i; j++) {
+      create_collision(scene, scene_get_body(scene, j),
+                       scene_get_body(scene, i), log_group_call,
+                       &groups[(i * 7 + j) % NUM_GROUPS], 0);
+    }
+  }
+  scene_tick(scene, 0);
+
+  size_t num_events = scene_num_collision_events(scene);
+  assert(num_events == NUM_BODIES * (NUM_BODIES - 1) / 2);
+  assert(log->num_calls == num_events);
+  bool handled[num_events];
+  for (size_t i = 0; i < num_events; i++) {
+    handled[i] = false;
+  }
+  size_t num_checked = 0;
+  for (size_t first = 0; first < num_events; first++) {
+    if (handled[first]) {
+      continue;
+    }
+    collision_event_t event = scene_get_collision_event(scene, first);
+    for (size_t i = first; i < num_events; i++) {
+      collision_event_t other = scene_get_collision_event(scene, i);
+      if (other.aux != event.aux) {
+        continue;
+      }
+      handled[i] = true;
+      size_t id1 = *(size_t *)body_get_info(other.body1);
+      size_t id2 = *(size_t *)body_get_info(other.body2);
+      size_t group = ((group_aux_t *)other.aux)->group;
+      assert(log->calls[num_checked++] == group * 10000 + id1 * 100 + id2);
+    }
+  }
+  assert(num_checked == num_events);
+  free(log);
+  scene_free(scene);
+}
+
+// Tests that a pair kept apart is rejected by its cached separating axis
+void test_separating_axis_cache() {
+  scene_t *scene = scene_init();
+  for (size_t i = 0; i < 2; i++) {
+    scene_add_body(scene, make_tagged_body(i));
+  }
+  // a diamond and a box whose bounding boxes overlap, though they don't
+  body_t *diamond = scene_get_body(scene, 0);
+  body_t *box = scene_get_body(scene, 1);
+  body_set_rotation(diamond, M_PI / 4);
+  body_set_centroid(box, (vector_t){2.2, 2.2});
+
+  call_log_t *log = malloc(sizeof(call_log_t));
+  log->num_calls = 0;
+  create_collision(scene, diamond, box, log_handler_call, log, 0);
+  axis_cache_stats_t *stats = scene_get_axis_cache_stats(scene);
+  for (size_t i = 0; i < 5; i++) {
+    scene_tick(scene, 0);
+  }
+  // the first tick runs the narrowphase, and the rest reuse its axis
+  assert(stats->tests == 4);
+  assert(stats->hits == 4);
+  assert(log->num_calls == 0);
+
+  body_set_centroid(box, (vector_t){1.9, 0});
+  scene_tick(scene, 0);
+  assert(stats->tests == 5);
+  assert(stats->hits == 4);
+  assert(log->num_calls == 1);
+
+  free(log);
+  scene_free(scene);
+}
+
 // Tests that force creators properly register their list of affected bodies.
 // If they don't, asan will report a heap-use-after-free failure.
 void test_forces_removed() {
@@ -164,6 +509,13 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_energy_conservation)
   DO_TEST(test_collisions)
   DO_TEST(test_forces_removed)
+  DO_TEST(test_resting_contact)
+  DO_TEST(test_stacked_contacts)
+  DO_TEST(test_layer_handlers)
+  DO_TEST(test_threaded_layer_handlers)
+  DO_TEST(test_collision_events)
+  DO_TEST(test_many_event_groups)
+  DO_TEST(test_separating_axis_cache)
 
   puts("forces_test PASS");
 }
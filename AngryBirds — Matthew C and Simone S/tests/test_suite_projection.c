@@ -0,0 +1,142 @@
+#include "polygon.h"
+#include "projection.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t MAX_POINTS = 37;
+
+double random_coord() { return (rand() % 20001 - 10000) / 7.0; }
+
+// Tests that the SIMD kernel matches the scalar one exactly, including the
+// points left over after the last full register
+void test_kernel_matches_scalar() {
+  double xs[MAX_POINTS];
+  double ys[MAX_POINTS];
+  for (size_t num_points = 0; num_points <= MAX_POINTS; num_points++) {
+    for (size_t i = 0; i < num_points; i++) {
+      xs[i] = random_coord();
+      ys[i] = random_coord();
+    }
+    for (size_t k = 0; k < 10; k++) {
+      double angle = 2 * M_PI * rand() / RAND_MAX;
+      vector_t axis = {cos(angle), sin(angle)};
+      vector_t expected = project_points_scalar(xs, ys, num_points, axis);
+      vector_t actual = project_points(xs, ys, num_points, axis);
+      assert(actual.x == expected.x && actual.y == expected.y);
+    }
+    // and starting partway through, like the scalar tail does
+    if (num_points > 1) {
+      vector_t axis = {0, 1};
+      vector_t expected =
+          project_points_scalar(xs + 1, ys + 1, num_points - 1, axis);
+      vector_t actual = project_points(xs + 1, ys + 1, num_points - 1, axis);
+      assert(vec_equal(actual, expected));
+    }
+  }
+
+  vector_t empty = project_points(xs, ys, 0, (vector_t){1, 0});
+  assert(empty.x == __DBL_MAX__ && empty.y == -__DBL_MAX__);
+}
+
+// Tests that a polygon's packed coordinates follow it as it moves
+void test_packed_points() {
+  list_t *points = list_init(3, free);
+  vector_t corners[] = {{0, 0}, {4, 0}, {0, 3}};
+  for (size_t i = 0; i < 3; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = corners[i];
+    list_add(points, v);
+  }
+  polygon_t *polygon = polygon_init(points, VEC_ZERO, 0, 0, 0, 0);
+
+  polygon_translate(polygon, (vector_t){10, 20});
+  polygon_rotate(polygon, 1.2, (vector_t){3, -4});
+  polygon_set_center(polygon, (vector_t){-7, 5});
+  const vector_t *vertices = polygon_get_vertices(polygon);
+  for (size_t i = 0; i < 3; i++) {
+    assert(polygon_get_xs(polygon)[i] == vertices[i].x);
+    assert(polygon_get_ys(polygon)[i] == vertices[i].y);
+  }
+
+  vector_t proj = project_points(polygon_get_xs(polygon),
+                                 polygon_get_ys(polygon), 3, (vector_t){1, 0});
+  double min = __DBL_MAX__;
+  double max = -__DBL_MAX__;
+  for (size_t i = 0; i < 3; i++) {
+    min = fmin(min, vertices[i].x);
+    max = fmax(max, vertices[i].x);
+  }
+  assert(proj.x == min && proj.y == max);
+
+  polygon_free(polygon);
+}
+
+// Tests that a polygon's vertices are found from its pose as it moves
+void test_vertices_follow_pose() {
+  vector_t corners[] = {{0, 0}, {4, 0}, {5, 2}, {0, 3}};
+  list_t *points = list_init(4, free);
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = corners[i];
+    list_add(points, v);
+  }
+  polygon_t *polygon = polygon_init(points, VEC_ZERO, 0, 0, 0, 0);
+  double area = polygon_area(polygon);
+  vector_t center = polygon_centroid(polygon);
+
+  // move the corners and centroid by hand alongside the polygon
+  for (size_t step = 0; step < 100; step++) {
+    vector_t translation = {sin(step), cos(step * 0.7)};
+    double angle = 0.3 * sin(step * 1.3);
+    vector_t pivot = {step % 7, -(double)(step % 5)};
+    polygon_translate(polygon, translation);
+    polygon_rotate(polygon, angle, pivot);
+    for (size_t i = 0; i < 4; i++) {
+      vector_t moved = vec_subtract(vec_add(corners[i], translation), pivot);
+      corners[i] = vec_add(vec_rotate(moved, angle), pivot);
+    }
+    vector_t moved = vec_subtract(vec_add(center, translation), pivot);
+    center = vec_add(vec_rotate(moved, angle), pivot);
+
+    // the vertices are only asked for now and then, like when drawing
+    if (step % 10 == 0) {
+      const vector_t *world = polygon_get_vertices(polygon);
+      for (size_t i = 0; i < 4; i++) {
+        assert(vec_isclose(world[i], corners[i]));
+      }
+    }
+  }
+
+  polygon_update_vertices(polygon);
+  const vector_t *world = polygon_get_vertices(polygon);
+  const double *xs = polygon_get_xs(polygon);
+  const double *ys = polygon_get_ys(polygon);
+  for (size_t i = 0; i < 4; i++) {
+    assert(vec_isclose(world[i], corners[i]));
+    assert(xs[i] == world[i].x);
+    assert(ys[i] == world[i].y);
+  }
+  assert(vec_isclose(polygon_centroid(polygon), center));
+  assert(isclose(polygon_area(polygon), area));
+
+  polygon_free(polygon);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  printf("projection kernel: %s\n", project_points_kernel());
+  DO_TEST(test_kernel_matches_scalar)
+  DO_TEST(test_packed_points)
+  DO_TEST(test_vertices_follow_pose)
+
+  puts("projection_test PASS");
+}
@@ -0,0 +1,78 @@
+#include "test_util.h"
+#include "thread_pool.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t NUM_INDICES = 1000;
+
+void mark_range(void *aux, size_t start, size_t end) {
+  size_t *marks = aux;
+  for (size_t i = start; i < end; i++) {
+    marks[i]++;
+  }
+}
+
+// Tests that every index is visited exactly once, however the loop is split
+void test_every_index_once() {
+  size_t *marks = calloc(NUM_INDICES, sizeof(size_t));
+  assert(marks);
+  for (size_t num_threads = 1; num_threads <= 8; num_threads++) {
+    thread_pool_t *pool = thread_pool_init(num_threads);
+    assert(thread_pool_num_threads(pool) == num_threads);
+    // including loops shorter than the number of threads
+    size_t counts[] = {0, 1, 3, NUM_INDICES};
+    for (size_t c = 0; c < 4; c++) {
+      for (size_t i = 0; i < NUM_INDICES; i++) {
+        marks[i] = 0;
+      }
+      thread_pool_for(pool, counts[c], mark_range, marks);
+      for (size_t i = 0; i < NUM_INDICES; i++) {
+        assert(marks[i] == (i < counts[c] ? 1 : 0));
+      }
+    }
+    thread_pool_free(pool);
+  }
+  free(marks);
+}
+
+void record_end(void *aux, size_t start, size_t end) {
+  size_t *ends = aux;
+  // each range writes only to the slot of its own start
+  ends[start] = end;
+}
+
+// Tests that the ranges are contiguous and in index order
+void test_contiguous_ranges() {
+  thread_pool_t *pool = thread_pool_init(4);
+  size_t *ends = calloc(10, sizeof(size_t));
+  assert(ends);
+  thread_pool_for(pool, 10, record_end, ends);
+
+  size_t start = 0;
+  size_t num_ranges = 0;
+  while (start < 10) {
+    assert(ends[start] > start);
+    start = ends[start];
+    num_ranges++;
+  }
+  assert(start == 10);
+  assert(num_ranges == thread_pool_num_threads(pool));
+
+  free(ends);
+  thread_pool_free(pool);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_every_index_once)
+  DO_TEST(test_contiguous_ranges)
+
+  puts("thread_pool_test PASS");
+}